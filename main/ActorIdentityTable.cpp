@@ -0,0 +1,153 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "ActorIdentityTable.h"
+
+#include <string.h>
+
+static_assert((APP_ACTOR_ID_TABLE_BUCKETS & (APP_ACTOR_ID_TABLE_BUCKETS - 1)) == 0,
+              "APP_ACTOR_ID_TABLE_BUCKETS must be a power of two");
+static_assert(APP_ACTOR_ID_TABLE_SIZE < ActorIdentityTable::kInvalidIndex, "APP_ACTOR_ID_TABLE_SIZE is too large");
+
+ActorIdentityTable ActorIdentityTable::sActorIds;
+
+void ActorIdentityTable::Init(void)
+{
+    memset(mEntries, 0, sizeof(mEntries));
+    memset(mBuckets, kInvalidIndex, sizeof(mBuckets));
+
+    for (Index i = 0; i < APP_ACTOR_ID_TABLE_SIZE; i++)
+    {
+        mEntries[i].Next = (i + 1 < APP_ACTOR_ID_TABLE_SIZE) ? i + 1 : kInvalidIndex;
+    }
+    mFreeList = 0;
+}
+
+uint32_t ActorIdentityTable::Hash(const uint8_t *aId, uint32_t aLen)
+{
+    // 32-bit FNV-1a.
+    uint32_t hash = 2166136261UL;
+
+    for (uint32_t i = 0; i < aLen; i++)
+    {
+        hash = (hash ^ aId[i]) * 16777619UL;
+    }
+
+    return hash;
+}
+
+ActorIdentityTable::Index ActorIdentityTable::Intern(const uint8_t *aId, uint32_t aLen)
+{
+    uint32_t hash;
+    Index    bucket;
+    Index    index;
+
+    if (aLen > kMaxIdLength)
+    {
+        return kInvalidIndex;
+    }
+
+    hash   = Hash(aId, aLen);
+    bucket = hash & (APP_ACTOR_ID_TABLE_BUCKETS - 1);
+
+    for (index = mBuckets[bucket]; index != kInvalidIndex; index = mEntries[index].Next)
+    {
+        Entry &entry = mEntries[index];
+
+        if (entry.Hash == hash && entry.Len == aLen && memcmp(entry.Id, aId, aLen) == 0)
+        {
+            __atomic_add_fetch(&entry.RefCount, 1, __ATOMIC_RELAXED);
+            return index;
+        }
+    }
+
+    index = AllocEntry();
+    if (index != kInvalidIndex)
+    {
+        Entry &entry = mEntries[index];
+
+        memcpy(entry.Id, aId, aLen);
+        entry.Len      = aLen;
+        entry.Hash     = hash;
+        entry.RefCount = 1;
+        entry.Next     = mBuckets[bucket];
+        mBuckets[bucket] = index;
+    }
+
+    return index;
+}
+
+void ActorIdentityTable::Release(Index aIndex)
+{
+    // Unreferenced entries stay in the table, so an identity that acts again is found without
+    // being copied in again.  They are only reclaimed when a new identity needs the space.
+    if (aIndex < APP_ACTOR_ID_TABLE_SIZE)
+    {
+        __atomic_sub_fetch(&mEntries[aIndex].RefCount, 1, __ATOMIC_RELEASE);
+    }
+}
+
+const uint8_t *ActorIdentityTable::Get(Index aIndex, uint8_t &aLen) const
+{
+    if (aIndex >= APP_ACTOR_ID_TABLE_SIZE)
+    {
+        aLen = 0;
+        return NULL;
+    }
+
+    aLen = mEntries[aIndex].Len;
+    return mEntries[aIndex].Id;
+}
+
+ActorIdentityTable::Index ActorIdentityTable::AllocEntry(void)
+{
+    Index index = mFreeList;
+
+    if (index != kInvalidIndex)
+    {
+        mFreeList = mEntries[index].Next;
+        return index;
+    }
+
+    // The table is full; reclaim an entry that nothing refers to.
+    for (index = 0; index < APP_ACTOR_ID_TABLE_SIZE; index++)
+    {
+        if (__atomic_load_n(&mEntries[index].RefCount, __ATOMIC_ACQUIRE) == 0)
+        {
+            Unlink(index);
+            return index;
+        }
+    }
+
+    return kInvalidIndex;
+}
+
+void ActorIdentityTable::Unlink(Index aIndex)
+{
+    Index *link = &mBuckets[mEntries[aIndex].Hash & (APP_ACTOR_ID_TABLE_BUCKETS - 1)];
+
+    while (*link != kInvalidIndex)
+    {
+        if (*link == aIndex)
+        {
+            *link = mEntries[aIndex].Next;
+            return;
+        }
+        link = &mEntries[*link].Next;
+    }
+}
@@ -0,0 +1,76 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "AppNvmStore.h"
+
+#include "nvm3.h"
+#include "nvm3_default.h"
+
+WEAVE_ERROR AppNvmStore::Read(Key aKey, void *aBuf, size_t aLen)
+{
+    uint32_t objectType;
+    size_t   objectLen;
+    Ecode_t  ecode;
+
+    ecode = nvm3_getObjectInfo(nvm3_defaultHandle, aKey, &objectType, &objectLen);
+    if (ecode == ECODE_NVM3_ERR_KEY_NOT_FOUND)
+    {
+        return WEAVE_DEVICE_ERROR_CONFIG_NOT_FOUND;
+    }
+    if (ecode != ECODE_NVM3_OK || objectType != NVM3_OBJECTTYPE_DATA || objectLen != aLen)
+    {
+        return WEAVE_ERROR_PERSISTED_STORAGE_FAIL;
+    }
+
+    ecode = nvm3_readData(nvm3_defaultHandle, aKey, aBuf, aLen);
+
+    return (ecode == ECODE_NVM3_OK) ? WEAVE_NO_ERROR : WEAVE_ERROR_PERSISTED_STORAGE_FAIL;
+}
+
+WEAVE_ERROR AppNvmStore::Write(Key aKey, const void *aData, size_t aLen)
+{
+    Ecode_t ecode = nvm3_writeData(nvm3_defaultHandle, aKey, aData, aLen);
+
+    return (ecode == ECODE_NVM3_OK) ? WEAVE_NO_ERROR : WEAVE_ERROR_PERSISTED_STORAGE_FAIL;
+}
+
+WEAVE_ERROR AppNvmStore::Delete(Key aKey)
+{
+    Ecode_t ecode = nvm3_deleteObject(nvm3_defaultHandle, aKey);
+
+    return (ecode == ECODE_NVM3_OK || ecode == ECODE_NVM3_ERR_KEY_NOT_FOUND) ? WEAVE_NO_ERROR
+                                                                             : WEAVE_ERROR_PERSISTED_STORAGE_FAIL;
+}
+
+WEAVE_ERROR AppNvmStore::EraseAll(void)
+{
+    WEAVE_ERROR err = WEAVE_NO_ERROR;
+
+    // Every record is attempted, so that one failure does not leave the others behind.
+    for (uint32_t key = kKeyBase + 1; key <= kKey_Last; key++)
+    {
+        WEAVE_ERROR deleteErr = Delete(static_cast<Key>(key));
+
+        if (deleteErr != WEAVE_NO_ERROR)
+        {
+            err = deleteErr;
+        }
+    }
+
+    return err;
+}
@@ -21,6 +21,9 @@
 #include "WDMFeature.h"
 #include "LEDWidget.h"
 #include "ButtonHandler.h"
+#include "CommandExpiryChecker.h"
+#include "ActorIdentityTable.h"
+#include "AppNvmStore.h"
 #include <schema/include/BoltLockTrait.h>
 
 #include "AppConfig.h"
@@ -57,7 +60,9 @@ static bool sIsServiceSubscriptionEstablished = false;
 static bool sHaveBLEConnections               = false;
 static bool sHaveServiceConnectivity          = false;
 
-static char sPackageSpecification[] = "Lock Example";
+// Identities of the actor of the lock action being initiated, consumed by ActionInitiated().
+static uint8_t sActionOriginator = ActorIdentityTable::kInvalidIndex;
+static uint8_t sActionAgent      = ActorIdentityTable::kInvalidIndex;
 
 static nl::Weave::Platform::Security::SHA256 sSHA256;
 
@@ -141,6 +146,15 @@ int AppTask::Init()
 
     BoltLockMgr().SetCallbacks(ActionInitiated, ActionCompleted);
 
+    ActorIds().Init();
+
+    err = ExpiryChecker().Init();
+    if (err != WEAVE_NO_ERROR)
+    {
+        EFR32_LOG("ExpiryChecker().Init() failed");
+        appError(err);
+    }
+
     sWeaveEventLock = xSemaphoreCreateMutex();
     if (sWeaveEventLock == NULL)
     {
@@ -263,12 +277,16 @@ void AppTask::LockActionEventHandler(AppEvent *aEvent)
     bool                      initiated = false;
     BoltLockManager::Action_t action;
     int32_t                   actor;
-    int                       err = WEAVE_NO_ERROR;
+    uint8_t                   originator = ActorIdentityTable::kInvalidIndex;
+    uint8_t                   agent      = ActorIdentityTable::kInvalidIndex;
+    int                       err        = WEAVE_NO_ERROR;
 
     if (aEvent->Type == AppEvent::kEventType_Lock)
     {
-        action = static_cast<BoltLockManager::Action_t>(aEvent->LockEvent.Action);
-        actor  = aEvent->LockEvent.Actor;
+        action     = static_cast<BoltLockManager::Action_t>(aEvent->LockEvent.Action);
+        actor      = aEvent->LockEvent.Actor;
+        originator = aEvent->LockEvent.Originator;
+        agent      = aEvent->LockEvent.Agent;
     }
     else if (aEvent->Type == AppEvent::kEventType_Button)
     {
@@ -282,6 +300,9 @@ void AppTask::LockActionEventHandler(AppEvent *aEvent)
         }
 
         actor = Schema::Weave::Trait::Security::BoltLockTrait::BOLT_LOCK_ACTOR_METHOD_PHYSICAL;
+
+        // Someone at the lock is likely to use the app next.
+        WdmFeature().PrewarmServiceSession();
     }
     else
     {
@@ -290,11 +311,30 @@ void AppTask::LockActionEventHandler(AppEvent *aEvent)
 
     if (err == WEAVE_NO_ERROR)
     {
+        // The bolt lock trait takes over the identity references if the action is initiated.
+        sActionOriginator = originator;
+        sActionAgent      = agent;
+
         initiated = BoltLockMgr().InitiateAction(actor, action);
 
+        sActionOriginator = ActorIdentityTable::kInvalidIndex;
+        sActionAgent      = ActorIdentityTable::kInvalidIndex;
+
         if (!initiated)
         {
             EFR32_LOG("Action is already in progress or active.");
+
+            ActorIds().Release(originator);
+            ActorIds().Release(agent);
+
+#if APP_DEFERRED_COMMAND_RESPONSE
+            // A remote request that started nothing is answered now, unless the action
+            // already in progress will answer it when it completes.
+            if (aEvent->Type == AppEvent::kEventType_Lock && !BoltLockMgr().IsActionInProgress())
+            {
+                WdmFeature().GetBoltLockTraitDataSource().CompletePendingCommand();
+            }
+#endif
         }
     }
 }
@@ -358,6 +398,12 @@ void AppTask::FunctionTimerEventHandler(AppEvent *aEvent)
     }
     else if (sAppTask.mFunctionTimerActive && sAppTask.mFunction == kFunction_FactoryReset)
     {
+        // The application's records are outside the configuration manager's key range.
+        if (AppNvmStore::EraseAll() != WEAVE_NO_ERROR)
+        {
+            EFR32_LOG("Failed to erase application records");
+        }
+
         // Actually trigger Factory Reset
         nl::Weave::DeviceLayer::ConfigurationMgr().InitiateFactoryReset();
     }
@@ -452,12 +498,12 @@ void AppTask::ActionInitiated(BoltLockManager::Action_t aAction, int32_t aActor)
     // and start flashing the LEDs rapidly to indicate action initiation.
     if (aAction == BoltLockManager::LOCK_ACTION)
     {
-        WdmFeature().GetBoltLockTraitDataSource().InitiateLock(aActor);
+        WdmFeature().GetBoltLockTraitDataSource().InitiateLock(aActor, sActionOriginator, sActionAgent);
         EFR32_LOG("Lock Action has been initiated")
     }
     else if (aAction == BoltLockManager::UNLOCK_ACTION)
     {
-        WdmFeature().GetBoltLockTraitDataSource().InitiateUnlock(aActor);
+        WdmFeature().GetBoltLockTraitDataSource().InitiateUnlock(aActor, sActionOriginator, sActionAgent);
         EFR32_LOG("Unlock Action has been initiated")
     }
 
@@ -487,25 +533,31 @@ void AppTask::ActionCompleted(BoltLockManager::Action_t aAction)
     }
 }
 
-void AppTask::PostLockActionRequest(int32_t aActor, BoltLockManager::Action_t aAction)
+bool AppTask::PostLockActionRequest(int32_t aActor, uint8_t aOriginator, uint8_t aAgent,
+                                    BoltLockManager::Action_t aAction)
 {
     AppEvent event;
-    event.Type             = AppEvent::kEventType_Lock;
-    event.LockEvent.Actor  = aActor;
-    event.LockEvent.Action = aAction;
-    event.Handler          = LockActionEventHandler;
-    PostEvent(&event);
+    event.Type                 = AppEvent::kEventType_Lock;
+    event.LockEvent.Actor      = aActor;
+    event.LockEvent.Originator = aOriginator;
+    event.LockEvent.Agent      = aAgent;
+    event.LockEvent.Action     = aAction;
+    event.Handler              = LockActionEventHandler;
+    return PostEvent(&event);
 }
 
-void AppTask::PostEvent(const AppEvent *aEvent)
+bool AppTask::PostEvent(const AppEvent *aEvent)
 {
     if (sAppEventQueue != NULL)
     {
         if (!xQueueSend(sAppEventQueue, aEvent, 1))
         {
             EFR32_LOG("Failed to post event to app task event queue");
+            return false;
         }
+        return true;
     }
+    return false;
 }
 
 void AppTask::DispatchEvent(AppEvent *aEvent)
@@ -634,6 +686,8 @@ void AppTask::HandleSoftwareUpdateEvent(void *
             EFR32_LOG("No partial image detected in local storage");
             aOutParam.FetchPartialImageInfo.PartialImageLen = 0;
         }
+
+        WdmFeature().GetTrafficScheduler().OnBulkTransferStarting(aOutParam.FetchPartialImageInfo.PartialImageLen);
         break;
     }
 
@@ -663,6 +717,7 @@ void AppTask::HandleSoftwareUpdateEvent(void *
     case SoftwareUpdateManager::kEvent_StartImageDownload:
     {
         EFR32_LOG("Starting Image Download");
+        WdmFeature().GetTrafficScheduler().OnBulkTransferStarted();
         break;
     }
     case SoftwareUpdateManager::kEvent_StoreImageBlock:
@@ -676,6 +731,10 @@ void AppTask::HandleSoftwareUpdateEvent(void *
     case SoftwareUpdateManager::kEvent_ComputeImageIntegrity:
     {
         EFR32_LOG("Computing image integrity");
+
+        // The image has been received; the rest of the update is local.
+        WdmFeature().GetTrafficScheduler().OnBulkTransferFinished(true);
+
         EFR32_LOG("Total image length: %" PRId32, persistedImageLen);
 
         // Make sure that the buffer provided in the parameter is large enough.
@@ -722,6 +781,9 @@ void AppTask::HandleSoftwareUpdateEvent(void *
 
     case SoftwareUpdateManager::kEvent_Finished:
     {
+        WdmFeature().GetTrafficScheduler().OnBulkTransferFinished(aInParam.Finished.Error == WEAVE_NO_ERROR &&
+                                                                  aInParam.Finished.StatusReport == NULL);
+
         if (aInParam.Finished.Error == WEAVE_ERROR_NO_SW_UPDATE_AVAILABLE)
         {
             EFR32_LOG("No Software Update Available");
@@ -72,14 +72,46 @@ bool BoltLockManager::IsUnlocked()
     return (mState == kState_UnlockingCompleted) ? true : false;
 }
 
-void BoltLockManager::EnableAutoRelock(bool aOn)
+void BoltLockManager::SetAutoRelockConfig(bool aOn, uint32_t aDurationInSecs)
 {
-    mAutoRelock = aOn;
+    bool changed = (aOn != mAutoRelock || aDurationInSecs != mAutoLockDuration);
+
+    mAutoRelock       = aOn;
+    mAutoLockDuration = aDurationInSecs;
+
+    if (changed && mAutoLockTimerArmed)
+    {
+        if (aOn)
+        {
+            // Re-arm with the new duration.
+            StartTimer(mAutoLockDuration * 1000);
+
+            EFR32_LOG("Auto Re-lock rescheduled in %u seconds", mAutoLockDuration);
+        }
+        else
+        {
+            mAutoLockTimerArmed = false;
+
+            CancelTimer();
+
+            EFR32_LOG("Auto Re-lock cancelled");
+        }
+    }
 }
 
-void BoltLockManager::SetAutoLockDuration(uint32_t aDurationInSecs)
+void BoltLockManager::PostAutoRelockConfig(bool aOn, uint32_t aDurationInSecs)
 {
-    mAutoLockDuration = aDurationInSecs;
+    AppEvent event;
+    event.Type                               = AppEvent::kEventType_LockConfig;
+    event.LockConfigEvent.AutoRelockOn       = aOn;
+    event.LockConfigEvent.AutoRelockDuration = aDurationInSecs;
+    event.Handler                            = AutoRelockConfigEventHandler;
+    GetAppTask().PostEvent(&event);
+}
+
+void BoltLockManager::AutoRelockConfigEventHandler(AppEvent *aEvent)
+{
+    sLock.SetAutoRelockConfig(aEvent->LockConfigEvent.AutoRelockOn != 0, aEvent->LockConfigEvent.AutoRelockDuration);
 }
 
 bool BoltLockManager::InitiateAction(int32_t aActor, Action_t aAction)
@@ -0,0 +1,202 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "CommandExpiryChecker.h"
+
+#include "AppConfig.h"
+#include "AppNvmStore.h"
+
+using namespace ::nl::Weave;
+using namespace ::nl::Weave::DeviceLayer;
+
+CommandExpiryChecker CommandExpiryChecker::sExpiryChecker;
+
+WEAVE_ERROR CommandExpiryChecker::Init(void)
+{
+    WEAVE_ERROR     err;
+    ClockCheckpoint checkpoint;
+
+    mUtcOffsetMS        = 0;
+    mSyncMonotonicMS    = 0;
+    mBootLowerBoundMS   = 0;
+    mHaveOffset         = false;
+    mHaveBootLowerBound = false;
+
+    err = AppNvmStore::Read(AppNvmStore::kKey_ClockCheckpoint, &checkpoint, sizeof(checkpoint));
+    if (err == WEAVE_NO_ERROR)
+    {
+        mBootLowerBoundMS   = checkpoint.UtcTimeMS;
+        mHaveBootLowerBound = true;
+
+        // Keep checkpointing before the first sync too, so that the next boot knows this one ran.
+        PlatformMgr().ScheduleWork(AsyncStartCheckpointTimer);
+    }
+    else if (err != WEAVE_DEVICE_ERROR_CONFIG_NOT_FOUND)
+    {
+        EFR32_LOG("Failed to read clock checkpoint: %s", ErrorStr(err));
+    }
+
+    PlatformMgr().AddEventHandler(HandlePlatformEvent);
+
+    return WEAVE_NO_ERROR;
+}
+
+void CommandExpiryChecker::HandlePlatformEvent(const WeaveDeviceEvent *event, intptr_t arg)
+{
+    if (event->Type == DeviceEventType::kTimeSyncChange && event->TimeSyncChange.IsTimeSynchronized)
+    {
+        sExpiryChecker.RecordSync(true);
+        SystemLayer.StartTimer(APP_CLOCK_CHECKPOINT_INTERVAL_MS, HandleCheckpointTimer, NULL);
+    }
+}
+
+void CommandExpiryChecker::AsyncStartCheckpointTimer(intptr_t arg)
+{
+    SystemLayer.StartTimer(APP_CLOCK_CHECKPOINT_INTERVAL_MS, HandleCheckpointTimer, NULL);
+}
+
+void CommandExpiryChecker::HandleCheckpointTimer(System::Layer *aLayer, void *aAppState, System::Error aError)
+{
+    uint64_t utcTimeMS;
+
+    // Keep the persisted checkpoint within one interval of the current time for as long as the
+    // device runs, with one write per interval, so that Check() can tell after a reboot which
+    // expiry times this boot may have seen.  Without a synchronized clock, the checkpoint is the
+    // best lower bound on the time.
+    if (System::Platform::Layer::GetClock_RealTimeMS(utcTimeMS) == WEAVE_NO_ERROR)
+    {
+        sExpiryChecker.RecordSync(true);
+    }
+    else if (sExpiryChecker.GetLowerBound(utcTimeMS))
+    {
+        sExpiryChecker.PersistCheckpoint(utcTimeMS);
+    }
+
+    SystemLayer.StartTimer(APP_CLOCK_CHECKPOINT_INTERVAL_MS, HandleCheckpointTimer, NULL);
+}
+
+bool CommandExpiryChecker::GetLowerBound(uint64_t & aUtcTimeMS) const
+{
+    uint64_t monotonicMS = System::Platform::Layer::GetClock_MonotonicMS();
+
+    if (mHaveOffset)
+    {
+        uint64_t sinceSyncMS    = monotonicMS - mSyncMonotonicMS;
+        int64_t  driftAllowance = static_cast<int64_t>(APP_CLOCK_DRIFT_BASE_ALLOWANCE_MS +
+                                                      (sinceSyncMS * APP_CLOCK_DRIFT_PPM) / 1000000);
+
+        aUtcTimeMS = static_cast<uint64_t>(static_cast<int64_t>(monotonicMS) + mUtcOffsetMS - driftAllowance);
+        return true;
+    }
+
+    if (mHaveBootLowerBound)
+    {
+        aUtcTimeMS = mBootLowerBoundMS + monotonicMS;
+        return true;
+    }
+
+    return false;
+}
+
+void CommandExpiryChecker::PersistCheckpoint(uint64_t aUtcTimeMS)
+{
+    ClockCheckpoint checkpoint = { aUtcTimeMS };
+    WEAVE_ERROR     err;
+
+    err = AppNvmStore::Write(AppNvmStore::kKey_ClockCheckpoint, &checkpoint, sizeof(checkpoint));
+    if (err != WEAVE_NO_ERROR)
+    {
+        EFR32_LOG("Failed to persist clock checkpoint: %s", ErrorStr(err));
+    }
+}
+
+void CommandExpiryChecker::RecordSync(bool aPersist)
+{
+    uint64_t utcTimeMS;
+    uint64_t monotonicMS = System::Platform::Layer::GetClock_MonotonicMS();
+
+    if (System::Platform::Layer::GetClock_RealTimeMS(utcTimeMS) != WEAVE_NO_ERROR)
+    {
+        return;
+    }
+
+    mUtcOffsetMS     = static_cast<int64_t>(utcTimeMS) - static_cast<int64_t>(monotonicMS);
+    mSyncMonotonicMS = monotonicMS;
+    mHaveOffset      = true;
+
+    if (aPersist)
+    {
+        PersistCheckpoint(utcTimeMS);
+    }
+}
+
+CommandExpiryChecker::Result CommandExpiryChecker::Check(int64_t aExpiryTimeMicroSecond)
+{
+    int64_t  expiryTimeMS = aExpiryTimeMicroSecond / 1000;
+    uint64_t monotonicMS  = System::Platform::Layer::GetClock_MonotonicMS();
+    uint64_t utcTimeMS;
+
+    if (System::Platform::Layer::GetClock_RealTimeMS(utcTimeMS) == WEAVE_NO_ERROR)
+    {
+        // Keep the offset fresh while the clock is synchronized.
+        RecordSync(false);
+
+        return (expiryTimeMS < static_cast<int64_t>(utcTimeMS)) ? kResult_Expired : kResult_NotExpired;
+    }
+
+    if (mHaveOffset)
+    {
+        // The monotonic clock may have drifted since the last sync; give the command the benefit
+        // of the doubt, within the worst-case drift.
+        uint64_t sinceSyncMS    = monotonicMS - mSyncMonotonicMS;
+        int64_t  driftAllowance = static_cast<int64_t>(APP_CLOCK_DRIFT_BASE_ALLOWANCE_MS +
+                                                      (sinceSyncMS * APP_CLOCK_DRIFT_PPM) / 1000000);
+        int64_t estimatedUtcMS = static_cast<int64_t>(monotonicMS) + mUtcOffsetMS;
+
+        return (expiryTimeMS + driftAllowance < estimatedUtcMS) ? kResult_Expired : kResult_NotExpired;
+    }
+
+    if (mHaveBootLowerBound)
+    {
+        int64_t lowerBoundMS = static_cast<int64_t>(mBootLowerBoundMS + monotonicMS);
+
+        // The previous boot ran until at most one checkpoint interval past the checkpoint, so a
+        // command it could have received expires no later than that plus the horizon.  Such a
+        // command may be a replay, however long the device was off; only the synchronized
+        // clock can tell.
+        int64_t previousBootEndMS = static_cast<int64_t>(mBootLowerBoundMS + APP_CLOCK_CHECKPOINT_INTERVAL_MS +
+                                                         APP_CLOCK_DRIFT_BASE_ALLOWANCE_MS);
+
+        if (expiryTimeMS < lowerBoundMS)
+        {
+            return kResult_Expired;
+        }
+
+        if (expiryTimeMS <= previousBootEndMS + APP_CLOCK_CHECKPOINT_HORIZON_MS)
+        {
+            return kResult_TimeUnknown;
+        }
+
+        // The device may have been off for any length of time, so an expiry far beyond the lower
+        // bound proves nothing.  Only accept commands that expire within the horizon of it.
+        return (expiryTimeMS - lowerBoundMS <= APP_CLOCK_CHECKPOINT_HORIZON_MS) ? kResult_NotExpired
+                                                                                 : kResult_TimeUnknown;
+    }
+
+    return kResult_TimeUnknown;
+}
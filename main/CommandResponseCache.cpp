@@ -0,0 +1,106 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "CommandResponseCache.h"
+
+#include <string.h>
+
+void CommandResponseCache::Init(void)
+{
+    memset(mEntries, 0, sizeof(mEntries));
+    mNextEntry   = 0;
+    mLookupCount = 0;
+    mHitCount    = 0;
+}
+
+bool CommandResponseCache::Key::Matches(const Key &aOther) const
+{
+    return PeerNodeId == aOther.PeerNodeId && CommandType == aOther.CommandType &&
+        ExpiryTimeMicroSecond == aOther.ExpiryTimeMicroSecond && IsMustBeVersionValid == aOther.IsMustBeVersionValid &&
+        (!IsMustBeVersionValid || MustBeVersion == aOther.MustBeVersion);
+}
+
+bool CommandResponseCache::MakeKey(uint64_t aPeerNodeId, uint64_t aCommandType, bool aIsExpiryTimeValid,
+                                   int64_t aExpiryTimeMicroSecond, bool aIsMustBeVersionValid, uint64_t aMustBeVersion,
+                                   Key &aKey)
+{
+    memset(&aKey, 0, sizeof(aKey));
+
+    if (!aIsExpiryTimeValid)
+    {
+        return false;
+    }
+
+    aKey.PeerNodeId            = aPeerNodeId;
+    aKey.CommandType           = aCommandType;
+    aKey.ExpiryTimeMicroSecond = aExpiryTimeMicroSecond;
+    aKey.IsMustBeVersionValid  = aIsMustBeVersionValid;
+    aKey.MustBeVersion         = aIsMustBeVersionValid ? aMustBeVersion : 0;
+
+    return true;
+}
+
+const CommandResponseCache::Entry *CommandResponseCache::Find(const Key &aKey)
+{
+    mLookupCount++;
+
+    for (uint8_t i = 0; i < APP_COMMAND_RESPONSE_CACHE_SIZE; i++)
+    {
+        const Entry &entry = mEntries[i];
+
+        if (entry.InUse && entry.CommandKey.Matches(aKey))
+        {
+            mHitCount++;
+            return &entry;
+        }
+    }
+
+    return NULL;
+}
+
+void CommandResponseCache::AddSuccess(const Key &aKey, uint64_t aResponseVersion)
+{
+    Entry *entry = AllocEntry(aKey);
+
+    entry->IsSuccess       = true;
+    entry->ResponseVersion = aResponseVersion;
+}
+
+void CommandResponseCache::AddError(const Key &aKey, uint32_t aStatusProfileId, uint16_t aStatusCode)
+{
+    Entry *entry = AllocEntry(aKey);
+
+    entry->IsSuccess       = false;
+    entry->StatusProfileId = aStatusProfileId;
+    entry->StatusCode      = aStatusCode;
+}
+
+CommandResponseCache::Entry *CommandResponseCache::AllocEntry(const Key &aKey)
+{
+    // Entries are recycled round-robin, so the cache always holds the most
+    // recently processed commands.
+    Entry *entry = &mEntries[mNextEntry];
+
+    mNextEntry = (mNextEntry + 1) % APP_COMMAND_RESPONSE_CACHE_SIZE;
+
+    memset(entry, 0, sizeof(*entry));
+    entry->InUse      = true;
+    entry->CommandKey = aKey;
+
+    return entry;
+}
@@ -0,0 +1,205 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "EventOffloadController.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+
+using namespace ::nl::Weave::Profiles::DataManagement_Current;
+
+static_assert(kImportanceType_First == ProductionCritical && kImportanceType_Last == Debug,
+              "Event buffer sizes are listed from ProductionCritical to Debug");
+
+static_assert(WEAVE_CONFIG_EVENT_LOGGING_BYTE_THRESHOLD >= WEAVE_DEVICE_CONFIG_EVENT_LOGGING_CRIT_BUFFER_SIZE &&
+                  WEAVE_CONFIG_EVENT_LOGGING_BYTE_THRESHOLD >= WEAVE_DEVICE_CONFIG_EVENT_LOGGING_PROD_BUFFER_SIZE &&
+                  WEAVE_CONFIG_EVENT_LOGGING_BYTE_THRESHOLD >= WEAVE_DEVICE_CONFIG_EVENT_LOGGING_INFO_BUFFER_SIZE &&
+                  WEAVE_CONFIG_EVENT_LOGGING_BYTE_THRESHOLD >= WEAVE_DEVICE_CONFIG_EVENT_LOGGING_DEBUG_BUFFER_SIZE,
+              "The logger's own offload threshold must not fire before the high-water marks");
+
+static const char * const sBufferNames[EventOffloadController::kNumBuffers] = { "crit", "prod", "info", "debug" };
+
+void EventOffloadController::Init(void)
+{
+    memset(this, 0, sizeof(*this));
+
+    // Everything retained at this point is still to be offloaded.
+    for (uint8_t i = 0; i < kNumBuffers; i++)
+    {
+        ImportanceType importance = static_cast<ImportanceType>(kImportanceType_First + i);
+
+        mNextEventId[i]       = LoggingManagement::GetInstance().GetFirstEventID(importance);
+        mLastLoggedEventId[i] = LoggingManagement::GetInstance().GetLastEventID(importance);
+    }
+
+    mLastBytesWritten = LoggingManagement::GetInstance().GetBytesWritten();
+}
+
+uint32_t EventOffloadController::GetAverageEventSize(void) const
+{
+    return (mMeasuredEvents != 0) ? mMeasuredBytes / mMeasuredEvents : APP_EVENT_OFFLOAD_EVENT_SIZE_ESTIMATE;
+}
+
+uint32_t EventOffloadController::GetBufferSize(uint8_t aBuffer)
+{
+    static const uint32_t sBufferSizes[kNumBuffers] = {
+        WEAVE_DEVICE_CONFIG_EVENT_LOGGING_CRIT_BUFFER_SIZE,
+        WEAVE_DEVICE_CONFIG_EVENT_LOGGING_PROD_BUFFER_SIZE,
+        WEAVE_DEVICE_CONFIG_EVENT_LOGGING_INFO_BUFFER_SIZE,
+        WEAVE_DEVICE_CONFIG_EVENT_LOGGING_DEBUG_BUFFER_SIZE,
+    };
+
+    return sBufferSizes[aBuffer];
+}
+
+void EventOffloadController::Update(void)
+{
+    uint32_t bytesWritten = LoggingManagement::GetInstance().GetBytesWritten();
+    uint32_t newEvents    = 0;
+
+    // The logger counts the bytes of every event it writes, across all buffers.
+    for (uint8_t i = 0; i < kNumBuffers; i++)
+    {
+        event_id_t lastId = LoggingManagement::GetInstance().GetLastEventID(
+            static_cast<ImportanceType>(kImportanceType_First + i));
+
+        if (lastId > mLastLoggedEventId[i])
+        {
+            newEvents += lastId - mLastLoggedEventId[i];
+            mLastLoggedEventId[i] = lastId;
+        }
+    }
+
+    if (newEvents != 0)
+    {
+        mMeasuredBytes += bytesWritten - mLastBytesWritten;
+        mMeasuredEvents += newEvents;
+        mLastBytesWritten = bytesWritten;
+    }
+
+    for (uint8_t i = 0; i < kNumBuffers; i++)
+    {
+        ImportanceType importance = static_cast<ImportanceType>(kImportanceType_First + i);
+        event_id_t firstId        = LoggingManagement::GetInstance().GetFirstEventID(importance);
+        event_id_t lastId         = LoggingManagement::GetInstance().GetLastEventID(importance);
+        BufferStats & buffer      = mBuffers[i];
+        uint32_t fillBytes;
+
+        // The logger has overwritten events that were never offloaded.
+        if (firstId > mNextEventId[i])
+        {
+            buffer.Evicted += firstId - mNextEventId[i];
+            mNextEventId[i] = firstId;
+        }
+
+        buffer.Pending = (lastId >= mNextEventId[i]) ? lastId - mNextEventId[i] + 1 : 0;
+
+        fillBytes = buffer.Pending * GetAverageEventSize();
+        buffer.FillPercent =
+            (fillBytes >= GetBufferSize(i)) ? 100 : static_cast<uint8_t>(fillBytes * 100 / GetBufferSize(i));
+
+        if (buffer.FillPercent > buffer.MaxFillPercent)
+        {
+            buffer.MaxFillPercent = buffer.FillPercent;
+        }
+    }
+}
+
+bool EventOffloadController::ShouldOffloadNow(bool aHaveServiceConnectivity)
+{
+    uint8_t highWaterPercent = (aHaveServiceConnectivity) ? APP_EVENT_OFFLOAD_CONNECTED_HIGH_WATER_PERCENT
+                                                          : APP_EVENT_OFFLOAD_HIGH_WATER_PERCENT;
+
+    Update();
+
+    for (uint8_t i = 0; i < kNumBuffers; i++)
+    {
+        if (mBuffers[i].FillPercent >= highWaterPercent)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void EventOffloadController::OnNotifyStart(void)
+{
+    for (uint8_t i = 0; i < kNumBuffers; i++)
+    {
+        mInFlightEventId[i] =
+            LoggingManagement::GetInstance().GetLastEventID(static_cast<ImportanceType>(kImportanceType_First + i)) + 1;
+    }
+
+    mIsNotifyInFlight = true;
+}
+
+void EventOffloadController::OnNotifyAcked(void)
+{
+    uint32_t batchSize = 0;
+
+    if (!mIsNotifyInFlight)
+    {
+        return;
+    }
+
+    mIsNotifyInFlight = false;
+
+    // Count evictions up to now first, so that they are not credited as offloaded.
+    Update();
+
+    for (uint8_t i = 0; i < kNumBuffers; i++)
+    {
+        if (mInFlightEventId[i] > mNextEventId[i])
+        {
+            batchSize += mInFlightEventId[i] - mNextEventId[i];
+            mNextEventId[i] = mInFlightEventId[i];
+        }
+    }
+
+    Update();
+
+    if (batchSize == 0)
+    {
+        return;
+    }
+
+    mOffloads++;
+    mOffloadedEvents += batchSize;
+    if (batchSize > mMaxBatchSize)
+    {
+        mMaxBatchSize = batchSize;
+    }
+
+    Log();
+}
+
+void EventOffloadController::Log(void) const
+{
+    EFR32_LOG("Event offload: %" PRIu32 " events acknowledged in %" PRIu32 " batches (max %" PRIu32
+              "), %" PRIu32 " bytes per event",
+              mOffloadedEvents, mOffloads, mMaxBatchSize, GetAverageEventSize());
+
+    for (uint8_t i = 0; i < kNumBuffers; i++)
+    {
+        EFR32_LOG("  %s buffer: %u%% full (max %u%%), %" PRIu32 " evicted", sBufferNames[i], mBuffers[i].FillPercent,
+                  mBuffers[i].MaxFillPercent, mBuffers[i].Evicted);
+    }
+}
@@ -0,0 +1,53 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "ResubscribeBackoff.h"
+
+void ResubscribeBackoff::Init(uint32_t aBaseMS, uint32_t aCapMS, RandomFunct aRandom)
+{
+    mBaseMS = aBaseMS;
+    mCapMS  = aCapMS;
+    mRandom = aRandom;
+
+    Reset();
+}
+
+void ResubscribeBackoff::Reset(void)
+{
+    mPrevIntervalMS = mBaseMS;
+}
+
+uint32_t ResubscribeBackoff::NextIntervalMS(void)
+{
+    // The upper bound is held below the cap before multiplying, so it cannot overflow.
+    uint32_t upperMS = (mPrevIntervalMS < mCapMS / 3) ? mPrevIntervalMS * 3 : mCapMS;
+    uint32_t intervalMS;
+
+    if (upperMS <= mBaseMS)
+    {
+        intervalMS = mBaseMS;
+    }
+    else
+    {
+        intervalMS = mBaseMS + mRandom() % (upperMS - mBaseMS + 1);
+    }
+
+    mPrevIntervalMS = intervalMS;
+
+    return intervalMS;
+}
@@ -0,0 +1,84 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "RttEstimator.h"
+
+void RttEstimator::Init(uint32_t aInitialTimeoutMS, uint32_t aMinTimeoutMS, uint32_t aMaxTimeoutMS)
+{
+    mSmoothedRtt8         = 0;
+    mRttVariance4         = 0;
+    mMinTimeoutMS         = aMinTimeoutMS;
+    mMaxTimeoutMS         = aMaxTimeoutMS;
+    mSampleCount          = 0;
+    mDiscardedSampleCount = 0;
+    mRetransTimeoutMS     = aInitialTimeoutMS;
+}
+
+bool RttEstimator::AddSample(uint32_t aRoundTripMS, uint32_t aSentTimeoutMS)
+{
+    if (aRoundTripMS >= aSentTimeoutMS)
+    {
+        mDiscardedSampleCount++;
+        return Backoff();
+    }
+
+    if (mSampleCount++ == 0)
+    {
+        mSmoothedRtt8 = aRoundTripMS * 8;
+        mRttVariance4 = aRoundTripMS * 2;
+    }
+    else
+    {
+        // RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|;  SRTT = 7/8 SRTT + 1/8 R
+        uint32_t smoothedRtt = mSmoothedRtt8 / 8;
+        uint32_t deviation   = (smoothedRtt > aRoundTripMS) ? smoothedRtt - aRoundTripMS : aRoundTripMS - smoothedRtt;
+
+        mRttVariance4 = mRttVariance4 - (mRttVariance4 / 4) + deviation;
+        mSmoothedRtt8 = mSmoothedRtt8 - (mSmoothedRtt8 / 8) + aRoundTripMS;
+    }
+
+    return SetRetransTimeout(mSmoothedRtt8 / 8 + mRttVariance4);
+}
+
+bool RttEstimator::OnRetransmitFailure(void)
+{
+    return Backoff();
+}
+
+bool RttEstimator::Backoff(void)
+{
+    return SetRetransTimeout((mRetransTimeoutMS < mMaxTimeoutMS / 2) ? mRetransTimeoutMS * 2 : mMaxTimeoutMS);
+}
+
+bool RttEstimator::SetRetransTimeout(uint32_t aTimeoutMS)
+{
+    uint32_t oldTimeoutMS = mRetransTimeoutMS;
+
+    if (aTimeoutMS < mMinTimeoutMS)
+    {
+        aTimeoutMS = mMinTimeoutMS;
+    }
+    else if (aTimeoutMS > mMaxTimeoutMS)
+    {
+        aTimeoutMS = mMaxTimeoutMS;
+    }
+
+    mRetransTimeoutMS = aTimeoutMS;
+
+    return (mRetransTimeoutMS != oldTimeoutMS);
+}
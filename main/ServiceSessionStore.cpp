@@ -0,0 +1,395 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "ServiceSessionStore.h"
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <Weave/Support/crypto/CTRMode.h>
+#include <Weave/Support/crypto/HKDF.h>
+#include <Weave/Support/crypto/HMAC.h>
+#include <Weave/Support/crypto/WeaveCrypto.h>
+#include <Weave/Support/crypto/WeaveRNG.h>
+
+#include "AppNvmStore.h"
+
+using namespace ::nl::Weave;
+using namespace ::nl::Weave::Crypto;
+using namespace ::nl::Weave::DeviceLayer;
+
+static const uint8_t sWrappingKeyInfo[] = "ServiceSessionStore";
+
+void ServiceSessionStore::Init(uint64_t aTerminatingNodeId)
+{
+    mTerminatingNodeId          = aTerminatingNodeId;
+    mPrepareStartMS             = 0;
+    mResumeSetupTotalMS         = 0;
+    mResumeSetupCount           = 0;
+    mFullSetupTotalMS           = 0;
+    mFullSetupCount             = 0;
+    mPersistedNextMsgId         = 0;
+    mPersistedMaxRcvdMsgId      = 0;
+    mRestoredKeyId              = 0;
+    mPersistedKeyId             = 0;
+    mResumeCount                = 0;
+    mPersistedResumeCount       = 0;
+    mIsRestored                 = false;
+    mIsPreparing                = false;
+    mIsFirstSubscriptionPending = true;
+    mHaveWrappingKeys           = false;
+    mIsCheckpointScheduled      = false;
+
+    // Init runs on the app task, and the fabric state belongs to the Weave task.  The restore
+    // is queued ahead of the connectivity events that prepare the service binding.
+    PlatformMgr().ScheduleWork(AsyncRestore, reinterpret_cast<intptr_t>(this));
+}
+
+void ServiceSessionStore::AsyncRestore(intptr_t arg)
+{
+    ServiceSessionStore * _this = reinterpret_cast<ServiceSessionStore *>(arg);
+    WEAVE_ERROR err;
+
+#if APP_PERSIST_SERVICE_SESSION
+    err = _this->Restore();
+    if (err == WEAVE_NO_ERROR)
+    {
+        EFR32_LOG("Restored service session (key %04" PRIX16 ", resume %u)", _this->mRestoredKeyId,
+                  _this->mResumeCount);
+    }
+    else if (err != WEAVE_DEVICE_ERROR_CONFIG_NOT_FOUND)
+    {
+        EFR32_LOG("Not resuming persisted service session: %s", ErrorStr(err));
+        _this->Forget();
+    }
+#else
+    // A session persisted by a build with this enabled must not outlive it.
+    (void) err;
+    _this->Forget();
+#endif
+}
+
+void ServiceSessionStore::AsyncCheckpoint(intptr_t arg)
+{
+    ServiceSessionStore * _this = reinterpret_cast<ServiceSessionStore *>(arg);
+
+    _this->mIsCheckpointScheduled = false;
+    _this->Checkpoint();
+}
+
+void ServiceSessionStore::HandleCheckpointTimer(System::Layer * aLayer, void * aAppState, System::Error aError)
+{
+    ServiceSessionStore * _this = static_cast<ServiceSessionStore *>(aAppState);
+
+    _this->Checkpoint();
+    _this->StartCheckpointTimer();
+}
+
+void ServiceSessionStore::StartCheckpointTimer(void)
+{
+    // Catches messages received that no other checkpoint follows.
+    if (mPersistedKeyId != 0)
+    {
+        SystemLayer.StartTimer(APP_SERVICE_SESSION_CHECKPOINT_INTERVAL_MS, HandleCheckpointTimer, this);
+    }
+}
+
+WEAVE_ERROR ServiceSessionStore::GetWrappingKeys(void)
+{
+    WEAVE_ERROR err = WEAVE_NO_ERROR;
+    uint8_t privateKey[kMaxPrivateKeyLength];
+    uint8_t keys[kEncKeyLength + kMacKeyLength];
+    size_t privateKeyLen;
+
+    VerifyOrExit(!mHaveWrappingKeys, err = WEAVE_NO_ERROR);
+
+    err = ConfigurationMgr().GetDevicePrivateKey(privateKey, sizeof(privateKey), privateKeyLen);
+    SuccessOrExit(err);
+
+    err = HKDFSHA256::DeriveKey(NULL, 0, privateKey, static_cast<uint16_t>(privateKeyLen), NULL, 0, sWrappingKeyInfo,
+                                sizeof(sWrappingKeyInfo) - 1, keys, sizeof(keys), sizeof(keys));
+    SuccessOrExit(err);
+
+    memcpy(mEncKey, keys, kEncKeyLength);
+    memcpy(mMacKey, keys + kEncKeyLength, kMacKeyLength);
+    mHaveWrappingKeys = true;
+
+exit:
+    ClearSecretData(privateKey, sizeof(privateKey));
+    ClearSecretData(keys, sizeof(keys));
+    return err;
+}
+
+void ServiceSessionStore::ComputeTag(const PersistedSession & aSession, const uint8_t * aMacKey, uint8_t * aTag)
+{
+    HMACSHA256 hmac;
+
+    static_assert(HMACSHA256::kDigestLength == kTagLength, "Tag is an HMAC-SHA256 digest");
+
+    hmac.Begin(aMacKey, kMacKeyLength);
+    hmac.AddData(reinterpret_cast<const uint8_t *>(&aSession), offsetof(PersistedSession, Tag));
+    hmac.Finish(aTag);
+}
+
+WEAVE_ERROR ServiceSessionStore::Restore(void)
+{
+    WEAVE_ERROR err;
+    PersistedSession session;
+    WeaveEncryptionKey key;
+    uint8_t tag[kTagLength];
+    AES128CTRMode aes;
+    WeaveSessionKey * sessionKey = NULL;
+
+    err = AppNvmStore::Read(AppNvmStore::kKey_ServiceSession, &session, sizeof(session));
+    SuccessOrExit(err);
+
+    err = GetWrappingKeys();
+    SuccessOrExit(err);
+
+    ComputeTag(session, mMacKey, tag);
+    VerifyOrExit(ConstantTimeCompare(tag, session.Tag, kTagLength), err = WEAVE_ERROR_INTEGRITY_CHECK_FAILED);
+
+    VerifyOrExit(ConfigurationMgr().IsPairedToAccount() && session.FabricId == FabricState.FabricId,
+                 err = WEAVE_ERROR_INCORRECT_STATE);
+    VerifyOrExit(session.ResumeCount < APP_SERVICE_SESSION_MAX_RESUMES, err = WEAVE_ERROR_INCORRECT_STATE);
+
+    aes.SetKey(mEncKey);
+    aes.SetCounter(session.Nonce);
+    aes.EncryptData(session.WrappedKey, sizeof(session.WrappedKey), reinterpret_cast<uint8_t *>(&key));
+
+    err = FabricState.AllocSessionKey(mTerminatingNodeId, session.KeyId, NULL, sessionKey);
+    SuccessOrExit(err);
+
+    sessionKey->SetSharedSession(true);
+
+    err = FabricState.SetSessionKey(sessionKey, session.EncType, session.AuthMode, &key);
+    SuccessOrExit(err);
+
+    // Messages sent after the record was last written used counter values beyond it, but
+    // fewer than half the margin of them.
+    sessionKey->NextMsgId.Init(session.NextMsgId + APP_SERVICE_SESSION_MSG_ID_MARGIN);
+
+    // Messages received up to the last checkpoint are duplicates.
+    sessionKey->MaxRcvdMsgId = session.MaxRcvdMsgId;
+    sessionKey->RcvFlags     = static_cast<decltype(sessionKey->RcvFlags)>(session.RcvFlags);
+
+    mRestoredKeyId = session.KeyId;
+    mResumeCount   = session.ResumeCount + 1;
+    mIsRestored    = true;
+
+exit:
+    if (err != WEAVE_NO_ERROR && sessionKey != NULL)
+    {
+        FabricState.RemoveSessionKey(sessionKey);
+    }
+    aes.Reset();
+    ClearSecretData(reinterpret_cast<uint8_t *>(&key), sizeof(key));
+    ClearSecretData(reinterpret_cast<uint8_t *>(&session), sizeof(session));
+    return err;
+}
+
+WEAVE_ERROR ServiceSessionStore::Persist(const WeaveSessionKey & aSessionKey, uint16_t aKeyId, uint8_t aResumeCount)
+{
+    WEAVE_ERROR err;
+    PersistedSession session;
+    AES128CTRMode aes;
+    bool isFirstRecord;
+
+    memset(&session, 0, sizeof(session));
+    session.FabricId     = FabricState.FabricId;
+    session.NextMsgId    = aSessionKey.NextMsgId.GetValue();
+    session.MaxRcvdMsgId = aSessionKey.MaxRcvdMsgId;
+    session.RcvFlags     = aSessionKey.RcvFlags;
+    session.KeyId        = aKeyId;
+    session.AuthMode     = aSessionKey.AuthMode;
+    session.EncType      = aSessionKey.MsgEncKey.EncType;
+    session.ResumeCount  = aResumeCount;
+
+    err = GetWrappingKeys();
+    SuccessOrExit(err);
+
+    // A fresh counter block for each record, so that no keystream is ever reused.
+    err = Platform::Security::GetSecureRandomData(session.Nonce, sizeof(session.Nonce));
+    SuccessOrExit(err);
+
+    aes.SetKey(mEncKey);
+    aes.SetCounter(session.Nonce);
+    aes.EncryptData(reinterpret_cast<const uint8_t *>(&aSessionKey.MsgEncKey.EncKey), sizeof(session.WrappedKey),
+                    session.WrappedKey);
+
+    ComputeTag(session, mMacKey, session.Tag);
+
+    err = AppNvmStore::Write(AppNvmStore::kKey_ServiceSession, &session, sizeof(session));
+    SuccessOrExit(err);
+
+    isFirstRecord          = (mPersistedKeyId == 0);
+    mPersistedKeyId        = aKeyId;
+    mPersistedNextMsgId    = session.NextMsgId;
+    mPersistedMaxRcvdMsgId = session.MaxRcvdMsgId;
+    mPersistedResumeCount  = aResumeCount;
+
+    if (isFirstRecord)
+    {
+        StartCheckpointTimer();
+    }
+
+exit:
+    aes.Reset();
+    ClearSecretData(reinterpret_cast<uint8_t *>(&session), sizeof(session));
+    return err;
+}
+
+void ServiceSessionStore::Forget(void)
+{
+    WEAVE_ERROR err = AppNvmStore::Delete(AppNvmStore::kKey_ServiceSession);
+
+    if (err != WEAVE_NO_ERROR)
+    {
+        EFR32_LOG("Failed to delete persisted service session: %s", ErrorStr(err));
+    }
+
+    mPersistedKeyId = 0;
+    SystemLayer.CancelTimer(HandleCheckpointTimer, this);
+}
+
+void ServiceSessionStore::OnBindingPrepare(void)
+{
+    mPrepareStartMS = System::Platform::Layer::GetClock_MonotonicMS();
+    mIsPreparing    = true;
+}
+
+void ServiceSessionStore::OnBindingReady(Binding * aBinding)
+{
+    uint16_t keyId = aBinding->GetKeyId();
+    bool isResumed = (mIsRestored && keyId == mRestoredKeyId);
+    WeaveSessionKey * sessionKey;
+
+    if (mIsPreparing)
+    {
+        uint32_t setupMS = static_cast<uint32_t>(System::Platform::Layer::GetClock_MonotonicMS() - mPrepareStartMS);
+
+        // A binding that found the session already in use took no time to set it up.
+        if (isResumed)
+        {
+            mResumeSetupTotalMS += setupMS;
+            mResumeSetupCount++;
+        }
+        else if (keyId != mPersistedKeyId)
+        {
+            mFullSetupTotalMS += setupMS;
+            mFullSetupCount++;
+        }
+
+        EFR32_LOG("Service session ready in %" PRIu32 " ms (%s); average %" PRIu32 " ms resumed, %" PRIu32
+                  " ms with CASE",
+                  setupMS, (isResumed) ? "resumed" : (keyId != mPersistedKeyId) ? "CASE" : "existing",
+                  (mResumeSetupCount != 0) ? mResumeSetupTotalMS / mResumeSetupCount : 0,
+                  (mFullSetupCount != 0) ? mFullSetupTotalMS / mFullSetupCount : 0);
+
+        mIsPreparing = false;
+    }
+
+#if APP_PERSIST_SERVICE_SESSION
+    if (FabricState.FindSessionKey(keyId, mTerminatingNodeId, false, sessionKey) == WEAVE_NO_ERROR)
+    {
+        WEAVE_ERROR err = Persist(*sessionKey, keyId, (isResumed) ? mResumeCount : 0);
+
+        if (err != WEAVE_NO_ERROR)
+        {
+            EFR32_LOG("Failed to persist service session: %s", ErrorStr(err));
+            Forget();
+        }
+    }
+#else
+    (void) sessionKey;
+#endif
+}
+
+void ServiceSessionStore::Checkpoint(void)
+{
+#if APP_PERSIST_SERVICE_SESSION
+    WeaveSessionKey * sessionKey;
+    WEAVE_ERROR err;
+
+    VerifyOrExit(mPersistedKeyId != 0, err = WEAVE_NO_ERROR);
+
+    err = FabricState.FindSessionKey(mPersistedKeyId, mTerminatingNodeId, false, sessionKey);
+    SuccessOrExit(err);
+
+    // Unsigned arithmetic, so that counter wrap is handled.
+    VerifyOrExit(sessionKey->NextMsgId.GetValue() - mPersistedNextMsgId >= APP_SERVICE_SESSION_MSG_ID_MARGIN / 2 ||
+                     sessionKey->MaxRcvdMsgId - mPersistedMaxRcvdMsgId >= APP_SERVICE_SESSION_RCVD_MSG_ID_BLOCK,
+                 err = WEAVE_NO_ERROR);
+
+    err = Persist(*sessionKey, mPersistedKeyId, mPersistedResumeCount);
+
+exit:
+    if (err != WEAVE_NO_ERROR)
+    {
+        // A record whose counters may fall behind must not be resumed.
+        EFR32_LOG("Failed to checkpoint service session: %s", ErrorStr(err));
+        Forget();
+    }
+#endif
+}
+
+void ServiceSessionStore::OnMessageReceived(uint16_t aKeyId)
+{
+#if APP_PERSIST_SERVICE_SESSION
+    if (mPersistedKeyId != 0 && aKeyId == mPersistedKeyId && !mIsCheckpointScheduled)
+    {
+        mIsCheckpointScheduled = true;
+        PlatformMgr().ScheduleWork(AsyncCheckpoint, reinterpret_cast<intptr_t>(this));
+    }
+#else
+    (void) aKeyId;
+#endif
+}
+
+void ServiceSessionStore::OnSessionFailed(WEAVE_ERROR aReason)
+{
+    mIsPreparing = false;
+
+    // The service no longer has the session; the next attempt runs CASE.
+    if (aReason == WEAVE_ERROR_KEY_NOT_FOUND_FROM_PEER && (mIsRestored || mPersistedKeyId != 0))
+    {
+        EFR32_LOG("Service rejected the persisted session, falling back to CASE");
+
+        Forget();
+        mIsRestored = false;
+    }
+}
+
+void ServiceSessionStore::OnPairingRemoved(void)
+{
+    Forget();
+    mIsRestored = false;
+}
+
+void ServiceSessionStore::OnServiceSubscriptionEstablished(void)
+{
+    if (mIsFirstSubscriptionPending)
+    {
+        EFR32_LOG("First service subscription established %" PRIu32 " ms after boot (session %s)",
+                  static_cast<uint32_t>(System::Platform::Layer::GetClock_MonotonicMS()),
+                  (mIsRestored) ? "resumed" : "from CASE");
+
+        mIsFirstSubscriptionPending = false;
+    }
+}
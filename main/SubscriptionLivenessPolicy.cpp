@@ -0,0 +1,129 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "SubscriptionLivenessPolicy.h"
+
+#include <inttypes.h>
+
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+
+using namespace ::nl::Weave::DeviceLayer;
+
+static_assert(APP_SUBSCRIPTION_LIVENESS_MIN_SEC <= APP_SUBSCRIPTION_LIVENESS_MAX_SEC,
+              "APP_SUBSCRIPTION_LIVENESS_MIN_SEC must not exceed APP_SUBSCRIPTION_LIVENESS_MAX_SEC");
+
+void SubscriptionLivenessPolicy::Init(uint32_t aResponseTimeoutMS)
+{
+    mResponseTimeoutMS = aResponseTimeoutMS;
+
+    UpdateFloor();
+
+    mTargetSec    = mFloorSec;
+    mRequestedSec = mFloorSec;
+}
+
+void SubscriptionLivenessPolicy::UpdateFloor(void)
+{
+    ConnectivityManager::ThreadPollingConfig pollingConfig;
+    uint32_t                                 pollBudgetMS;
+
+    // A sleepy device may take a full inactive polling interval to hear each message of the
+    // exchange, so allow for several.
+    ConnectivityMgr().GetThreadPollingConfig(pollingConfig);
+
+    pollBudgetMS = APP_SUBSCRIPTION_LIVENESS_POLL_PERIODS * pollingConfig.InactivePollingIntervalMS;
+    mFloorSec    = (mResponseTimeoutMS + pollBudgetMS + 999) / 1000;
+
+    if (mFloorSec < APP_SUBSCRIPTION_LIVENESS_MIN_SEC)
+    {
+        mFloorSec = APP_SUBSCRIPTION_LIVENESS_MIN_SEC;
+    }
+    else if (mFloorSec > APP_SUBSCRIPTION_LIVENESS_MAX_SEC)
+    {
+        mFloorSec = APP_SUBSCRIPTION_LIVENESS_MAX_SEC;
+    }
+}
+
+void SubscriptionLivenessPolicy::GetRequestRange(uint32_t &aTimeoutSecMin, uint32_t &aTimeoutSecMax)
+{
+    // The polling configuration may have changed since the last subscription.
+    UpdateFloor();
+
+    if (mTargetSec < mFloorSec)
+    {
+        mTargetSec = mFloorSec;
+    }
+
+    mRequestedSec = mTargetSec;
+
+    aTimeoutSecMin = mFloorSec;
+    aTimeoutSecMax = mTargetSec;
+}
+
+uint32_t SubscriptionLivenessPolicy::SelectTimeout(uint32_t aOfferedSecMin, uint32_t aOfferedSecMax) const
+{
+    if (mTargetSec < aOfferedSecMin)
+    {
+        return aOfferedSecMin;
+    }
+
+    if (aOfferedSecMax >= aOfferedSecMin && mTargetSec > aOfferedSecMax)
+    {
+        return aOfferedSecMax;
+    }
+
+    return mTargetSec;
+}
+
+uint32_t SubscriptionLivenessPolicy::GetStablePeriodMS(void) const
+{
+    if (mTargetSec >= APP_SUBSCRIPTION_LIVENESS_MAX_SEC)
+    {
+        return 0;
+    }
+
+    return APP_SUBSCRIPTION_LIVENESS_STABLE_PERIODS * mTargetSec * 1000;
+}
+
+bool SubscriptionLivenessPolicy::OnStablePeriodElapsed(void)
+{
+    mTargetSec *= 2;
+
+    if (mTargetSec > APP_SUBSCRIPTION_LIVENESS_MAX_SEC)
+    {
+        mTargetSec = APP_SUBSCRIPTION_LIVENESS_MAX_SEC;
+    }
+
+    EFR32_LOG("Subscription stable; liveness timeout target now %" PRIu32 " s", mTargetSec);
+
+    // Each renewal costs a subscribe exchange, but as the target doubles each time there are
+    // only a few before it reaches the maximum.
+    return (mTargetSec != mRequestedSec);
+}
+
+void SubscriptionLivenessPolicy::OnSubscriptionFailed(void)
+{
+    mTargetSec /= 2;
+
+    if (mTargetSec < mFloorSec)
+    {
+        mTargetSec = mFloorSec;
+    }
+
+    EFR32_LOG("Subscription failed; liveness timeout target now %" PRIu32 " s", mTargetSec);
+}
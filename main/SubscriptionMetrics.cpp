@@ -0,0 +1,196 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "SubscriptionMetrics.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+
+using namespace ::nl::Weave;
+
+void SubscriptionMetrics::Init(void)
+{
+    memset(this, 0, sizeof(*this));
+}
+
+uint32_t SubscriptionMetrics::ElapsedMS(uint64_t aStartMS)
+{
+    return static_cast<uint32_t>(System::Platform::Layer::GetClock_MonotonicMS() - aStartMS);
+}
+
+void SubscriptionMetrics::Record(Histogram &aHistogram, uint32_t aBaseMS, uint32_t aValueMS)
+{
+    uint8_t bucket = 0;
+
+    while (bucket < kNumHistogramBuckets - 1 && aValueMS >= (aBaseMS << bucket))
+    {
+        bucket++;
+    }
+
+    aHistogram.Counts[bucket]++;
+}
+
+void SubscriptionMetrics::OnServiceConnectivityChange(bool aHaveServiceConnectivity)
+{
+    if (aHaveServiceConnectivity && !mHaveServiceConnectivity)
+    {
+        mSubscribeStartMS              = System::Platform::Layer::GetClock_MonotonicMS();
+        mCounterSubscribeStartMS       = mSubscribeStartMS;
+        mIsAwaitingSubscription        = true;
+        mIsAwaitingCounterSubscription = true;
+    }
+    else if (!aHaveServiceConnectivity)
+    {
+        // Time spent without connectivity is not counted against the subscriptions.
+        mIsAwaitingSubscription        = false;
+        mIsAwaitingCounterSubscription = false;
+    }
+
+    mHaveServiceConnectivity = aHaveServiceConnectivity;
+}
+
+void SubscriptionMetrics::OnSubscriptionEstablished(void)
+{
+    if (mIsAwaitingSubscription)
+    {
+        uint32_t latencyMS = ElapsedMS(mSubscribeStartMS);
+
+        Record(mSubscribeLatency, kSubscribeLatencyBaseMS, latencyMS);
+        mIsAwaitingSubscription = false;
+
+        EFR32_LOG("Service subscription established %" PRIu32 " ms after connectivity", latencyMS);
+    }
+}
+
+void SubscriptionMetrics::OnCounterSubscriptionEstablished(void)
+{
+    if (mIsAwaitingCounterSubscription)
+    {
+        uint32_t latencyMS = ElapsedMS(mCounterSubscribeStartMS);
+
+        Record(mCounterSubscribeLatency, kSubscribeLatencyBaseMS, latencyMS);
+        mIsAwaitingCounterSubscription = false;
+
+        EFR32_LOG("Service counter-subscription established %" PRIu32 " ms after connectivity", latencyMS);
+    }
+}
+
+void SubscriptionMetrics::OnSubscriptionTerminated(WEAVE_ERROR aReason, bool aIsStatusCodeValid,
+                                                   uint32_t aStatusProfileId, uint16_t aStatusCode, bool aWillRetry)
+{
+    CountTermination(aReason, aIsStatusCodeValid, aStatusProfileId, aStatusCode);
+
+    mIsResubscribePending = aWillRetry;
+
+    if (aWillRetry)
+    {
+        if (aIsStatusCodeValid)
+        {
+            mResubscribeCauses[kResubscribeCause_StatusReport]++;
+        }
+        else if (aReason == WEAVE_ERROR_TIMEOUT)
+        {
+            mResubscribeCauses[kResubscribeCause_Timeout]++;
+        }
+        else
+        {
+            mResubscribeCauses[kResubscribeCause_Other]++;
+        }
+    }
+
+    // A lost subscription is a reconnection; time it from here.
+    if (mHaveServiceConnectivity && !mIsAwaitingSubscription)
+    {
+        mSubscribeStartMS       = System::Platform::Layer::GetClock_MonotonicMS();
+        mIsAwaitingSubscription = true;
+    }
+}
+
+void SubscriptionMetrics::OnCounterSubscriptionTerminated(WEAVE_ERROR aReason, uint32_t aStatusProfileId,
+                                                          uint16_t aStatusCode)
+{
+    CountTermination(aReason, (aReason == WEAVE_ERROR_STATUS_REPORT_RECEIVED), aStatusProfileId, aStatusCode);
+
+    if (mHaveServiceConnectivity && !mIsAwaitingCounterSubscription)
+    {
+        mCounterSubscribeStartMS       = System::Platform::Layer::GetClock_MonotonicMS();
+        mIsAwaitingCounterSubscription = true;
+    }
+}
+
+void SubscriptionMetrics::OnSubscribeRequest(void)
+{
+    // A request following a terminated subscription that the client retries is a
+    // resubscribe attempt.
+    if (mIsResubscribePending)
+    {
+        mResubscribeAttempts++;
+        mIsResubscribePending = false;
+    }
+}
+
+void SubscriptionMetrics::OnNotifyRoundTrip(uint32_t aRoundTripMS)
+{
+    Record(mNotifyRoundTripTime, kNotifyRoundTripBaseMS, aRoundTripMS);
+}
+
+void SubscriptionMetrics::CountTermination(WEAVE_ERROR aReason, bool aIsStatusCodeValid, uint32_t aStatusProfileId,
+                                           uint16_t aStatusCode)
+{
+    uint32_t profileId = (aIsStatusCodeValid) ? aStatusProfileId : static_cast<uint32_t>(kLocalErrorProfileId);
+    uint16_t code      = (aIsStatusCodeValid) ? aStatusCode : static_cast<uint16_t>(aReason);
+
+    for (uint8_t i = 0; i < mNumTerminationReasons; i++)
+    {
+        if (mTerminationReasons[i].ProfileId == profileId && mTerminationReasons[i].StatusCode == code)
+        {
+            mTerminationReasons[i].Count++;
+            return;
+        }
+    }
+
+    if (mNumTerminationReasons < kMaxTerminationReasons)
+    {
+        TerminationReason &reason = mTerminationReasons[mNumTerminationReasons++];
+
+        reason.ProfileId  = profileId;
+        reason.StatusCode = code;
+        reason.Count      = 1;
+    }
+    else
+    {
+        mTerminationReasonsDropped++;
+    }
+}
+
+void SubscriptionMetrics::Log(void) const
+{
+    EFR32_LOG("Subscription metrics: %" PRIu32 " resubscribe attempts (timeout %" PRIu32 ", status report %" PRIu32
+              ", other %" PRIu32 "), %u termination reasons (+%" PRIu32 " dropped)",
+              mResubscribeAttempts, mResubscribeCauses[kResubscribeCause_Timeout],
+              mResubscribeCauses[kResubscribeCause_StatusReport], mResubscribeCauses[kResubscribeCause_Other],
+              mNumTerminationReasons, mTerminationReasonsDropped);
+
+    for (uint8_t i = 0; i < mNumTerminationReasons; i++)
+    {
+        EFR32_LOG("  termination %08" PRIX32 ":%04" PRIX16 " x%" PRIu32, mTerminationReasons[i].ProfileId,
+                  mTerminationReasons[i].StatusCode, mTerminationReasons[i].Count);
+    }
+}
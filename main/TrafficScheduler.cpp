@@ -0,0 +1,198 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "TrafficScheduler.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+
+using namespace ::nl::Weave;
+using namespace ::nl::Weave::DeviceLayer;
+
+static const char * const sClassNames[TrafficScheduler::kTrafficClass_Max] = { "interactive", "events", "bulk" };
+
+void TrafficScheduler::Init(SchedulingFunct aSchedulingFunct)
+{
+    memset(this, 0, sizeof(*this));
+
+    mSchedulingFunct = aSchedulingFunct;
+}
+
+void TrafficScheduler::OnInteractiveExchange(void)
+{
+    if (!mIsInteractiveWindowOpen)
+    {
+        mIsInteractiveWindowOpen = true;
+        mInteractiveWindows++;
+    }
+
+    // Restarting the timer extends the window from this exchange.
+    SystemLayer.StartTimer(APP_TRAFFIC_INTERACTIVE_HOLD_MS, HandleInteractiveHoldTimer, this);
+
+    if (mIsBulkTransferActive && !mIsBulkPreempted && mTransferPreemptions < APP_TRAFFIC_MAX_BULK_PREEMPTIONS)
+    {
+        mIsBulkPreempted = true;
+        mTransferPreemptions++;
+        mBulkPreemptions++;
+
+        EFR32_LOG("Image download preempted by interactive traffic (%u of %u)", mTransferPreemptions,
+                  APP_TRAFFIC_MAX_BULK_PREEMPTIONS);
+
+        mSchedulingFunct(kTrafficClass_Bulk, false);
+    }
+}
+
+bool TrafficScheduler::MayProceed(TrafficClass aClass)
+{
+    if (aClass == kTrafficClass_Interactive || !mIsInteractiveWindowOpen)
+    {
+        return true;
+    }
+
+    mDeferrals[aClass]++;
+    mIsDeferred[aClass] = true;
+
+    return false;
+}
+
+void TrafficScheduler::HandleInteractiveHoldTimer(System::Layer * aLayer, void * aAppState, System::Error aError)
+{
+    static_cast<TrafficScheduler *>(aAppState)->CloseInteractiveWindow();
+}
+
+void TrafficScheduler::CloseInteractiveWindow(void)
+{
+    bool resumed = false;
+
+    mIsInteractiveWindowOpen = false;
+
+    // Resume the held back classes in order.
+    if (mIsDeferred[kTrafficClass_Events])
+    {
+        mIsDeferred[kTrafficClass_Events] = false;
+        mSchedulingFunct(kTrafficClass_Events, true);
+        resumed = true;
+    }
+
+    if (mIsDeferred[kTrafficClass_Bulk] || mIsBulkPreempted)
+    {
+        mIsBulkResumePending            = mIsBulkPreempted;
+        mIsDeferred[kTrafficClass_Bulk] = false;
+        mIsBulkPreempted                = false;
+        mSchedulingFunct(kTrafficClass_Bulk, true);
+        resumed = true;
+    }
+
+    if (resumed)
+    {
+        Log();
+    }
+}
+
+void TrafficScheduler::OnBulkTransferStarting(uint32_t aPartialLen)
+{
+    if (!mIsBulkResumePending)
+    {
+        return;
+    }
+
+    mIsBulkResumePending = false;
+
+    if (aPartialLen != 0)
+    {
+        mBulkResumes++;
+    }
+    else
+    {
+        mBulkRestarts++;
+    }
+
+    EFR32_LOG("Preempted image download %s at offset %" PRIu32 " (%" PRIu32 " resumed, %" PRIu32 " restarted)",
+              (aPartialLen != 0) ? "resumed" : "restarted", aPartialLen, mBulkResumes, mBulkRestarts);
+}
+
+void TrafficScheduler::OnBulkTransferStarted(void)
+{
+    mIsBulkTransferActive = true;
+}
+
+void TrafficScheduler::OnBulkTransferFinished(bool aCompleted)
+{
+    mIsBulkTransferActive = false;
+
+    // A download stopped by a preemption carries on when it is resumed; any other ends it.
+    if (!mIsBulkPreempted)
+    {
+        mIsBulkResumePending = false;
+
+        if (aCompleted && mTransferPreemptions > 0)
+        {
+            EFR32_LOG("Image download completed after %u preemptions", mTransferPreemptions);
+        }
+
+        mTransferPreemptions = 0;
+    }
+}
+
+void TrafficScheduler::OnCommandResponse(uint64_t aDispatchedMS)
+{
+    uint32_t latencyMS       = static_cast<uint32_t>(System::Platform::Layer::GetClock_MonotonicMS() - aDispatchedMS);
+    bool duringBulkTransfer  = (mIsBulkTransferActive || mIsBulkPreempted);
+    CommandLatency & latency = mCommandLatency[duringBulkTransfer ? 1 : 0];
+    uint8_t bucket           = 0;
+
+    while (bucket < kNumHistogramBuckets - 1 && latencyMS >= (static_cast<uint32_t>(kCommandLatencyBaseMS) << bucket))
+    {
+        bucket++;
+    }
+
+    latency.Counts[bucket]++;
+    latency.Commands++;
+    latency.TotalMS += latencyMS;
+
+    if (latencyMS > latency.MaxMS)
+    {
+        latency.MaxMS = latencyMS;
+    }
+
+    EFR32_LOG("Command latency %" PRIu32 " ms%s", latencyMS, duringBulkTransfer ? " during image download" : "");
+}
+
+void TrafficScheduler::Log(void) const
+{
+    EFR32_LOG("Traffic scheduler: %" PRIu32 " interactive windows, %" PRIu32 " image download preemptions (%" PRIu32
+              " resumed from the partial image, %" PRIu32 " restarted)",
+              mInteractiveWindows, mBulkPreemptions, mBulkResumes, mBulkRestarts);
+
+    for (uint8_t i = kTrafficClass_Events; i < kTrafficClass_Max; i++)
+    {
+        EFR32_LOG("  %s: %" PRIu32 " deferrals", sClassNames[i], mDeferrals[i]);
+    }
+
+    for (uint8_t i = 0; i < 2; i++)
+    {
+        const CommandLatency & latency = mCommandLatency[i];
+
+        EFR32_LOG("  command latency%s: %" PRIu32 " commands, mean %" PRIu32 " ms, max %" PRIu32 " ms",
+                  (i == 1) ? " during image download" : "", latency.Commands,
+                  (latency.Commands > 0) ? static_cast<uint32_t>(latency.TotalMS / latency.Commands) : 0,
+                  latency.MaxMS);
+    }
+}
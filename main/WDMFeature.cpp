@@ -19,8 +19,12 @@
 #include "WDMFeature.h"
 
 #include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+#include <Weave/DeviceLayer/SoftwareUpdateManager.h>
+
+#include <Weave/Support/RandUtils.h>
 
 #include "AppConfig.h"
+#include "AppNvmStore.h"
 
 using namespace ::nl;
 using namespace ::nl::Inet;
@@ -31,24 +35,22 @@ using namespace ::nl::Weave::Profiles::DataManagement_Current;
 
 // TODO: Remove this
 #define kServiceEndpoint_Data_Management 0x18B4300200000003ull ///< Core Weave data management protocol endpoint
-
-/** Defines the timeout for liveness between the service and the device.
- *  For sleepy end node devices, this timeout will be much larger than the current
- *  value to preserve battery.
- */
-#define SERVICE_LIVENESS_TIMEOUT_SEC 60 * 1 // 1 minute
+#define kServiceEndpoint_Core_Router 0x18B4300200000012ull     ///< Core router, which terminates shared sessions
 
 /** Defines the timeout for a response to any message initiated by the device to the service.
  *  This includes notifies, subscribe confirms, cancels and updates.
- *  This timeout is kept SERVICE_WRM_MAX_RETRANS x SERVICE_WRM_INITIAL_RETRANS_TIMEOUT_MS + some buffer
- *  to account for latency in the message transmission through multiple hops.
+ *  This timeout covers the original transmission and SERVICE_WRM_MAX_RETRANS retransmissions, each at
+ *  up to SERVICE_WRM_MAX_RETRANS_TIMEOUT_MS, which also accounts for latency in the message transmission
+ *  through multiple hops.
  */
 #define SERVICE_MESSAGE_RESPONSE_TIMEOUT_MS 10000
 
 /** Defines the timeout for a message to get retransmitted when no wrm ack or
- *  response has been heard back from the service. This timeout is kept larger
- *  for now since the message has to travel through multiple hops and service
- *  layers before actually making it to the actual receiver.
+ *  response has been heard back from the service.  The timeout is derived from
+ *  the round-trip time measured on the service path, within the min and max
+ *  values below; the initial value is used until the first measurement.  The
+ *  initial value is kept larger since the message has to travel through multiple
+ *  hops and service layers before actually making it to the actual receiver.
  *  @note
  *    WRM has an initial and active retransmission timeouts to interact with
  *    sleepy destination nodes. For the time being, the pinna WRM config would
@@ -56,8 +58,8 @@ using namespace ::nl::Weave::Profiles::DataManagement_Current;
  *    would not be interacting directly with a sleepy peer.
  */
 #define SERVICE_WRM_INITIAL_RETRANS_TIMEOUT_MS 2500
-
-#define SERVICE_WRM_ACTIVE_RETRANS_TIMEOUT_MS 2500
+#define SERVICE_WRM_MIN_RETRANS_TIMEOUT_MS 500
+#define SERVICE_WRM_MAX_RETRANS_TIMEOUT_MS 2500
 
 /** Define the maximum number of retransmissions in WRM
  */
@@ -74,9 +76,13 @@ using namespace ::nl::Weave::Profiles::DataManagement_Current;
  */
 #define SUBSCRIPTION_RESPONSE_TIMEOUT_MS 40000
 
-const nl::Weave::WRMPConfig gWRMPConfigService = {SERVICE_WRM_INITIAL_RETRANS_TIMEOUT_MS,
-                                                  SERVICE_WRM_ACTIVE_RETRANS_TIMEOUT_MS,
-                                                  SERVICE_WRM_PIGGYBACK_ACK_TIMEOUT_MS, SERVICE_WRM_MAX_RETRANS};
+#if (SERVICE_WRM_MAX_RETRANS + 1) * SERVICE_WRM_MAX_RETRANS_TIMEOUT_MS > SERVICE_MESSAGE_RESPONSE_TIMEOUT_MS
+#error "SERVICE_MESSAGE_RESPONSE_TIMEOUT_MS must allow for all WRM retransmissions at the maximum timeout"
+#endif
+
+#if WDM_PUBLISHER_MAX_NUM_SUBSCRIPTION_HANDLERS < 1 + APP_MAX_LOCAL_SUBSCRIBERS
+#error "WDM_PUBLISHER_MAX_NUM_SUBSCRIPTION_HANDLERS must allow for the counter-subscription and local subscribers"
+#endif
 
 WDMFeature WDMFeature::sWDMfeature;
 
@@ -88,15 +94,47 @@ SubscriptionEngine *SubscriptionEngine::GetInstance()
 WEAVE_ERROR PublisherLock::Init()
 {
     mRecursiveLock = xSemaphoreCreateRecursiveMutex();
+    mHoldStartUS   = 0;
+    mDepth         = 0;
+    memset(&mStats, 0, sizeof(mStats));
 
     return ((mRecursiveLock == NULL) ? WEAVE_ERROR_MAX : WEAVE_NO_ERROR);
 }
 
 WEAVE_ERROR PublisherLock::Lock()
 {
-    if (pdTRUE != xSemaphoreTakeRecursive((SemaphoreHandle_t)mRecursiveLock, portMAX_DELAY))
+    uint64_t requestUS = System::Platform::Layer::GetClock_MonotonicHiRes();
+    bool     contended = false;
+
+    // Try without blocking first, so that contention can be counted.
+    if (pdTRUE != xSemaphoreTakeRecursive((SemaphoreHandle_t)mRecursiveLock, 0))
     {
-        return WEAVE_ERROR_LOCKING_FAILURE;
+        contended = true;
+
+        if (pdTRUE != xSemaphoreTakeRecursive((SemaphoreHandle_t)mRecursiveLock, portMAX_DELAY))
+        {
+            return WEAVE_ERROR_LOCKING_FAILURE;
+        }
+    }
+
+    // The statistics are only touched by the task holding the mutex.
+    if (mDepth++ == 0)
+    {
+        uint64_t nowUS  = System::Platform::Layer::GetClock_MonotonicHiRes();
+        uint32_t waitUS = static_cast<uint32_t>(nowUS - requestUS);
+
+        mHoldStartUS = nowUS;
+        mStats.AcquireCount++;
+
+        if (contended)
+        {
+            mStats.ContendedCount++;
+        }
+
+        if (waitUS > mStats.MaxWaitUS)
+        {
+            mStats.MaxWaitUS = waitUS;
+        }
     }
 
     return WEAVE_NO_ERROR;
@@ -104,6 +142,18 @@ WEAVE_ERROR PublisherLock::Lock()
 
 WEAVE_ERROR PublisherLock::Unlock()
 {
+    if (--mDepth == 0)
+    {
+        uint32_t holdUS = static_cast<uint32_t>(System::Platform::Layer::GetClock_MonotonicHiRes() - mHoldStartUS);
+
+        mStats.TotalHoldUS += holdUS;
+
+        if (holdUS > mStats.MaxHoldUS)
+        {
+            mStats.MaxHoldUS = holdUS;
+        }
+    }
+
     if (pdTRUE != xSemaphoreGiveRecursive((SemaphoreHandle_t)mRecursiveLock))
     {
         return WEAVE_ERROR_LOCKING_FAILURE;
@@ -112,8 +162,17 @@ WEAVE_ERROR PublisherLock::Unlock()
     return WEAVE_NO_ERROR;
 }
 
+void PublisherLock::LogStats(void) const
+{
+    EFR32_LOG("Publisher lock: %" PRIu32 " acquisitions (%" PRIu32 " contended), max wait %" PRIu32
+              " us, max hold %" PRIu32 " us, avg hold %" PRIu32 " us",
+              mStats.AcquireCount, mStats.ContendedCount, mStats.MaxWaitUS, mStats.MaxHoldUS,
+              (mStats.AcquireCount != 0) ? static_cast<uint32_t>(mStats.TotalHoldUS / mStats.AcquireCount) : 0);
+}
+
 WDMFeature::WDMFeature(void)
-    : mServiceSinkTraitCatalog(ResourceIdentifier(ResourceIdentifier::SELF_NODE_ID),
+    : mSubscriptionDiagnosticsTraitSource(mSubscriptionMetrics, mServiceRtt)
+    , mServiceSinkTraitCatalog(ResourceIdentifier(ResourceIdentifier::SELF_NODE_ID),
                                mServiceSinkCatalogStore,
                                sizeof(mServiceSinkCatalogStore) / sizeof(mServiceSinkCatalogStore[0]))
     , mServiceSourceTraitCatalog(ResourceIdentifier(ResourceIdentifier::SELF_NODE_ID),
@@ -125,17 +184,216 @@ WDMFeature::WDMFeature(void)
     , mIsSubToServiceEstablished(false)
     , mIsServiceCounterSubEstablished(false)
     , mIsSubToServiceActivated(false)
+    , mWasServiceSubActivatable(false)
+    , mIsRenewingServiceSub(false)
+    , mNextPrewarm(0)
+    , mNumPrewarms(0)
+    , mPrewarmsSkipped(0)
+    , mLastLoggedMaxHoldUS(0)
+    , mNotifyStartMS(0)
+    , mNotifyRetransTimeoutMS(0)
+    , mNotifyBatchWindowMS(0)
+    , mNotifyBatchRequests(0)
+    , mNotifyRequests(0)
+    , mNotifyBursts(0)
+    , mIsNotifyBatchPending(false)
 {
+    memset(mLocalSubscribers, 0, sizeof(mLocalSubscribers));
+    memset(mNotifyCost, 0, sizeof(mNotifyCost));
+    memset(mPrewarmTimesMS, 0, sizeof(mPrewarmTimesMS));
 }
 
 void WDMFeature::AsyncProcessChanges(intptr_t arg)
 {
-    sWDMfeature.mSubscriptionEngine.GetNotificationEngine()->Run();
+    sWDMfeature.mNotifyRequests++;
+    sWDMfeature.mNotifyBatchRequests++;
+
+    // An urgent change is a lock-state notify; other traffic gives way to it.
+    if (arg == kNotifyUrgency_Urgent)
+    {
+        sWDMfeature.mTrafficScheduler.OnInteractiveExchange();
+    }
+
+#if APP_NOTIFY_BATCHING
+    // Hold the change back for the next burst, so that the radio wakes once for all of them,
+    // unless an event buffer is filling up and no interactive exchange is under way.  Only
+    // these batched offloads wait for interactive traffic; an urgent burst carries any pending
+    // events along with the trait data.
+    if (arg == kNotifyUrgency_Batched &&
+        (!sWDMfeature.mEventOffload.ShouldOffloadNow(ConnectivityMgr().HaveServiceConnectivity()) ||
+         !sWDMfeature.mTrafficScheduler.MayProceed(TrafficScheduler::kTrafficClass_Events)))
+    {
+        if (!sWDMfeature.mIsNotifyBatchPending)
+        {
+            sWDMfeature.mIsNotifyBatchPending = true;
+            SystemLayer.StartTimer(sWDMfeature.mNotifyBatchWindowMS, HandleNotifyBatchTimer, NULL);
+        }
+        return;
+    }
+#endif
+
+    sWDMfeature.RunNotificationEngine();
+}
+
+void WDMFeature::HandleNotifyBatchTimer(System::Layer *aLayer, void *aAppState, System::Error aError)
+{
+    sWDMfeature.RunNotificationEngine();
 }
 
-void WDMFeature::ProcessTraitChanges(void)
+void WDMFeature::HandleTrafficScheduling(TrafficScheduler::TrafficClass aClass, bool aMayProceed)
 {
-    PlatformMgr().ScheduleWork(AsyncProcessChanges);
+    switch (aClass)
+    {
+    case TrafficScheduler::kTrafficClass_Events:
+        // Offload the events held back by the interactive window, if they are still due.
+        if (aMayProceed && sWDMfeature.mIsNotifyBatchPending &&
+            sWDMfeature.mEventOffload.ShouldOffloadNow(ConnectivityMgr().HaveServiceConnectivity()))
+        {
+            sWDMfeature.RunNotificationEngine();
+        }
+        break;
+
+    case TrafficScheduler::kTrafficClass_Bulk:
+        // The software update manager has no way to pause a download, so a preempted one
+        // is aborted, and resumed from the partial image by a new update check.
+        if (!aMayProceed)
+        {
+            SoftwareUpdateMgr().Abort();
+        }
+        else if (!SoftwareUpdateMgr().IsInProgress())
+        {
+            SoftwareUpdateMgr().CheckNow();
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+void WDMFeature::RunNotificationEngine(void)
+{
+    bool     boltLockChanged;
+    uint64_t runStartUS;
+
+    if (mIsNotifyBatchPending)
+    {
+        SystemLayer.CancelTimer(HandleNotifyBatchTimer, NULL);
+        mIsNotifyBatchPending = false;
+    }
+
+    mNotifyBursts++;
+
+    EFR32_LOG("Notify burst for %" PRIu32 " changes (%" PRIu32 " changes in %" PRIu32 " bursts)", mNotifyBatchRequests,
+              mNotifyRequests, mNotifyBursts);
+
+    mNotifyBatchRequests = 0;
+
+    // Pick up trait state published by the app task before the notification engine looks for dirty data.
+    boltLockChanged = mBoltLockTraitSource.FlushPendingChanges();
+
+    runStartUS = System::Platform::Layer::GetClock_MonotonicHiRes();
+
+    mSubscriptionEngine.GetNotificationEngine()->Run();
+
+    mServiceSession.Checkpoint();
+
+    if (boltLockChanged)
+    {
+        RecordNotifyCost(CountEstablishedSubscribers(),
+                         static_cast<uint32_t>(System::Platform::Layer::GetClock_MonotonicHiRes() - runStartUS));
+    }
+
+    if (mPublisherLock.GetStats().MaxHoldUS != mLastLoggedMaxHoldUS)
+    {
+        mLastLoggedMaxHoldUS = mPublisherLock.GetStats().MaxHoldUS;
+        mPublisherLock.LogStats();
+    }
+}
+
+uint8_t WDMFeature::CountEstablishedSubscribers(void) const
+{
+    uint8_t count = (mIsServiceCounterSubEstablished) ? 1 : 0;
+
+    for (uint8_t i = 0; i < APP_MAX_LOCAL_SUBSCRIBERS; i++)
+    {
+        if (mLocalSubscribers[i].Handler != NULL && mLocalSubscribers[i].IsEstablished)
+        {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+void WDMFeature::RecordNotifyCost(uint8_t aNumSubscribers, uint32_t aRunUS)
+{
+    int32_t perSubscriberUS = 0;
+
+    if (aNumSubscribers == 0)
+    {
+        return;
+    }
+
+    mNotifyCost[aNumSubscribers].Runs++;
+    mNotifyCost[aNumSubscribers].TotalUS += aRunUS;
+
+    // The cost of each subscriber beyond the first, from the average run times with one
+    // and with this many subscribers.
+    if (aNumSubscribers > 1 && mNotifyCost[1].Runs != 0)
+    {
+        const NotifyCost &cost        = mNotifyCost[aNumSubscribers];
+        uint32_t          avgUS       = static_cast<uint32_t>(cost.TotalUS / cost.Runs);
+        uint32_t          singleAvgUS = static_cast<uint32_t>(mNotifyCost[1].TotalUS / mNotifyCost[1].Runs);
+
+        perSubscriberUS = (static_cast<int32_t>(avgUS) - static_cast<int32_t>(singleAvgUS)) / (aNumSubscribers - 1);
+    }
+
+    EFR32_LOG("BoltLockTrait notify to %u subscribers took %" PRIu32 " us (%+" PRId32
+              " us per additional subscriber, %" PRIu32 " shared leaf encodings from %" PRIu32 " snapshots)",
+              aNumSubscribers, aRunUS, perSubscriberUS, mBoltLockTraitSource.GetSnapshotReadCount(),
+              mBoltLockTraitSource.GetSnapshotBuildCount());
+}
+
+void WDMFeature::HandleNotifyAck(ExchangeContext *ec, void *msgCtxt)
+{
+    uint32_t roundTripMS =
+        static_cast<uint32_t>(System::Platform::Layer::GetClock_MonotonicMS() - sWDMfeature.mNotifyStartMS);
+
+    sWDMfeature.mSubscriptionMetrics.OnNotifyRoundTrip(roundTripMS);
+    sWDMfeature.mEventOffload.OnNotifyAcked();
+
+    if (sWDMfeature.mServiceRtt.AddSample(roundTripMS, sWDMfeature.mNotifyRetransTimeoutMS))
+    {
+        sWDMfeature.ApplyServiceWRMPConfig();
+    }
+}
+
+WRMPConfig WDMFeature::GetServiceWRMPConfig(void) const
+{
+    WRMPConfig config = { mServiceRtt.GetRetransTimeoutMS(), mServiceRtt.GetRetransTimeoutMS(),
+                          SERVICE_WRM_PIGGYBACK_ACK_TIMEOUT_MS, SERVICE_WRM_MAX_RETRANS };
+
+    return config;
+}
+
+void WDMFeature::ApplyServiceWRMPConfig(void)
+{
+    // Exchanges already in progress keep the timeout they were started with.
+    if (mServiceSubBinding != NULL)
+    {
+        mServiceSubBinding->SetDefaultWRMPConfig(GetServiceWRMPConfig());
+    }
+
+    if (mServiceCounterSubHandler != NULL)
+    {
+        mServiceCounterSubHandler->GetBinding()->SetDefaultWRMPConfig(GetServiceWRMPConfig());
+    }
+}
+
+void WDMFeature::ProcessTraitChanges(NotifyUrgency aUrgency)
+{
+    PlatformMgr().ScheduleWork(AsyncProcessChanges, static_cast<intptr_t>(aUrgency));
 }
 
 void WDMFeature::HandleSubscriptionEngineEvent(void *                                  appState,
@@ -166,12 +424,100 @@ void WDMFeature::InitiateSubscriptionToService(void)
 {
     EFR32_LOG("Initiating Subscription To Service");
 
-    mServiceSubClient->EnableResubscribe(NULL);
+    mServiceSubClient->EnableResubscribe(HandleResubscribePolicy);
     mServiceSubClient->InitiateSubscription();
 }
 
+void WDMFeature::RenewSubscriptionToService(void)
+{
+    EFR32_LOG("Renewing service subscription to apply a %" PRIu32 " s liveness timeout",
+              mLivenessPolicy.GetTargetSec());
+
+    // The service replaces the old subscription when the new one is established.  Any termination
+    // event raised by the abort is ours, not a sign of instability, so the handler ignores it
+    // while this flag is set.
+    mIsRenewingServiceSub = true;
+    mServiceSubClient->AbortSubscription();
+    mIsRenewingServiceSub      = false;
+    mIsSubToServiceEstablished = false;
+
+    InitiateSubscriptionToService();
+}
+
+void WDMFeature::PrewarmServiceSession(void)
+{
+    PlatformMgr().ScheduleWork(AsyncPrewarmServiceSession);
+}
+
+void WDMFeature::AsyncPrewarmServiceSession(intptr_t arg)
+{
+    uint64_t nowMS = System::Platform::Layer::GetClock_MonotonicMS();
+
+    // Nothing to do unless the subscription is waiting to retry.
+    if (!sWDMfeature.mIsSubToServiceActivated || sWDMfeature.mIsSubToServiceEstablished ||
+        sWDMfeature.mServiceSubClient->IsInProgressOrEstablished() || !ConnectivityMgr().HaveServiceConnectivity())
+    {
+        return;
+    }
+
+    if (sWDMfeature.mNumPrewarms == APP_SERVICE_PREWARM_MAX_PER_HOUR &&
+        nowMS - sWDMfeature.mPrewarmTimesMS[sWDMfeature.mNextPrewarm] < 60 * 60 * 1000)
+    {
+        sWDMfeature.mPrewarmsSkipped++;
+        EFR32_LOG("Service pre-warm skipped, hourly limit reached (%" PRIu32 " skipped)", sWDMfeature.mPrewarmsSkipped);
+        return;
+    }
+
+    sWDMfeature.mPrewarmTimesMS[sWDMfeature.mNextPrewarm] = nowMS;
+
+    sWDMfeature.mNextPrewarm = (sWDMfeature.mNextPrewarm + 1) % APP_SERVICE_PREWARM_MAX_PER_HOUR;
+    if (sWDMfeature.mNumPrewarms < APP_SERVICE_PREWARM_MAX_PER_HOUR)
+    {
+        sWDMfeature.mNumPrewarms++;
+    }
+
+    EFR32_LOG("Pre-warming service session on local activity");
+
+    sWDMfeature.mResubscribeBackoff.Reset();
+    sWDMfeature.mServiceSubClient->AbortSubscription();
+    sWDMfeature.InitiateSubscriptionToService();
+}
+
+void WDMFeature::HandleLivenessStableTimer(System::Layer *aLayer, void *aAppState, System::Error aError)
+{
+    uint32_t stablePeriodMS;
+
+    if (!sWDMfeature.mIsSubToServiceEstablished)
+    {
+        return;
+    }
+
+    if (sWDMfeature.mLivenessPolicy.OnStablePeriodElapsed())
+    {
+        sWDMfeature.RenewSubscriptionToService();
+        return;
+    }
+
+    stablePeriodMS = sWDMfeature.mLivenessPolicy.GetStablePeriodMS();
+    if (stablePeriodMS != 0)
+    {
+        aLayer->StartTimer(stablePeriodMS, HandleLivenessStableTimer, NULL);
+    }
+}
+
 void WDMFeature::TearDownSubscriptions(void)
 {
+    SystemLayer.CancelTimer(HandleLivenessStableTimer, NULL);
+
+    for (uint8_t i = 0; i < APP_MAX_LOCAL_SUBSCRIBERS; i++)
+    {
+        if (mLocalSubscribers[i].Handler != NULL)
+        {
+            mLocalSubscribers[i].Handler->AbortSubscription();
+            mLocalSubscribers[i].Handler = NULL;
+        }
+    }
+
     if (mServiceSubClient)
     {
         mServiceSubClient->AbortSubscription();
@@ -193,10 +539,11 @@ void WDMFeature::HandleServiceBindingEvent(void *
     switch (eventType)
     {
     case Binding::kEvent_PrepareRequested:
+        sWDMfeature.mServiceSession.OnBindingPrepare();
         outParam.PrepareRequested.PrepareError = binding->BeginConfiguration()
                                                      .Target_ServiceEndpoint(kServiceEndpoint_Data_Management)
                                                      .Transport_UDP_WRM()
-                                                     .Transport_DefaultWRMPConfig(gWRMPConfigService)
+                                                     .Transport_DefaultWRMPConfig(sWDMfeature.GetServiceWRMPConfig())
                                                      .Exchange_ResponseTimeoutMsec(SERVICE_MESSAGE_RESPONSE_TIMEOUT_MS)
                                                      .Security_SharedCASESession()
                                                      .PrepareBinding();
@@ -204,14 +551,17 @@ void WDMFeature::HandleServiceBindingEvent(void *
 
     case Binding::kEvent_PrepareFailed:
         EFR32_LOG("Failed to prepare service subscription binding: %s", ErrorStr(inParam.PrepareFailed.Reason));
+        sWDMfeature.mServiceSession.OnSessionFailed(inParam.PrepareFailed.Reason);
         break;
 
     case Binding::kEvent_BindingFailed:
         EFR32_LOG("Service subscription binding failed: %s", ErrorStr(inParam.BindingFailed.Reason));
+        sWDMfeature.mServiceSession.OnSessionFailed(inParam.BindingFailed.Reason);
         break;
 
     case Binding::kEvent_BindingReady:
         EFR32_LOG("Service subscription binding ready");
+        sWDMfeature.mServiceSession.OnBindingReady(binding);
         break;
 
     default:
@@ -219,6 +569,68 @@ void WDMFeature::HandleServiceBindingEvent(void *
     }
 }
 
+WDMFeature::LocalSubscriber *WDMFeature::FindLocalSubscriber(const SubscriptionHandler *aHandler)
+{
+    for (uint8_t i = 0; i < APP_MAX_LOCAL_SUBSCRIBERS; i++)
+    {
+        if (mLocalSubscribers[i].Handler != NULL && mLocalSubscribers[i].Handler == aHandler)
+        {
+            return &mLocalSubscribers[i];
+        }
+    }
+
+    return NULL;
+}
+
+bool WDMFeature::AdmitLocalSubscriber(const SubscriptionHandler::InEventParam &inParam, uint16_t &aStatusCode)
+{
+    const WeaveMessageInfo *msgInfo   = inParam.mSubscribeRequestParsed.mMsgInfo;
+    LocalSubscriber *       freeEntry = NULL;
+
+    // Local devices get the lock's own state, over an encrypted session.
+    VerifyOrExit(msgInfo->KeyId != WeaveKeyId::kNone, aStatusCode = Profiles::Common::kStatus_AccessDenied);
+
+    for (uint16_t i = 0; i < inParam.mSubscribeRequestParsed.mNumTraitInstances; i++)
+    {
+        TraitDataHandle handle = inParam.mSubscribeRequestParsed.mTraitInstanceList[i].mTraitDataHandle;
+
+        VerifyOrExit(handle == kSourceHandle_BoltLockTrait || handle == kSourceHandle_DeviceIdentityTrait,
+                     aStatusCode = Profiles::Common::kStatus_AccessDenied);
+    }
+
+    for (uint8_t i = 0; i < APP_MAX_LOCAL_SUBSCRIBERS; i++)
+    {
+        if (mLocalSubscribers[i].Handler == NULL)
+        {
+            if (freeEntry == NULL)
+            {
+                freeEntry = &mLocalSubscribers[i];
+            }
+        }
+        else if (mLocalSubscribers[i].NodeId == msgInfo->SourceNodeId)
+        {
+            // A device that subscribes again replaces its previous subscription.
+            SubscriptionHandler *previous = mLocalSubscribers[i].Handler;
+
+            mLocalSubscribers[i].Handler = NULL;
+            previous->AbortSubscription();
+
+            freeEntry = &mLocalSubscribers[i];
+        }
+    }
+
+    VerifyOrExit(freeEntry != NULL, aStatusCode = Profiles::Common::kStatus_Busy);
+
+    freeEntry->Handler       = inParam.mSubscribeRequestParsed.mHandler;
+    freeEntry->NodeId        = msgInfo->SourceNodeId;
+    freeEntry->IsEstablished = false;
+
+    return true;
+
+exit:
+    return false;
+}
+
 void WDMFeature::HandleInboundSubscriptionEvent(void *                                   aAppState,
                                                 SubscriptionHandler::EventID             eventType,
                                                 const SubscriptionHandler::InEventParam &inParam,
@@ -228,27 +640,52 @@ void WDMFeature::HandleInboundSubscriptionEvent(void *
     {
     case SubscriptionHandler::kEvent_OnSubscribeRequestParsed:
     {
-        Binding *binding = inParam.mSubscribeRequestParsed.mHandler->GetBinding();
+        Binding *binding  = inParam.mSubscribeRequestParsed.mHandler->GetBinding();
+        uint64_t sourceId = inParam.mSubscribeRequestParsed.mMsgInfo->SourceNodeId;
+        uint16_t statusCode;
 
-        if (inParam.mSubscribeRequestParsed.mIsSubscriptionIdValid &&
-            inParam.mSubscribeRequestParsed.mMsgInfo->SourceNodeId == kServiceEndpoint_Data_Management)
+        if (inParam.mSubscribeRequestParsed.mIsSubscriptionIdValid && sourceId == kServiceEndpoint_Data_Management)
         {
             EFR32_LOG(
                 "Inbound service counter-subscription request received (sub id %016" PRIX64 ", path count %" PRId16 ")",
                 inParam.mSubscribeRequestParsed.mSubscriptionId, inParam.mSubscribeRequestParsed.mNumTraitInstances);
 
             sWDMfeature.mServiceCounterSubHandler = inParam.mSubscribeRequestParsed.mHandler;
+
+            binding->SetDefaultResponseTimeout(SERVICE_MESSAGE_RESPONSE_TIMEOUT_MS);
+            binding->SetDefaultWRMPConfig(sWDMfeature.GetServiceWRMPConfig());
+        }
+        else if (sWDMfeature.AdmitLocalSubscriber(inParam, statusCode))
+        {
+            EFR32_LOG("Inbound subscription request from node %016" PRIX64 " accepted (path count %" PRId16 ")",
+                      sourceId, inParam.mSubscribeRequestParsed.mNumTraitInstances);
         }
         else
         {
+            EFR32_LOG("Inbound subscription request from node %016" PRIX64 " rejected: %s", sourceId,
+                      StatusReportStr(Profiles::kWeaveProfile_Common, statusCode));
+
+            inParam.mSubscribeRequestParsed.mHandler->EndSubscription(Profiles::kWeaveProfile_Common, statusCode);
             break;
         }
 
-        binding->SetDefaultResponseTimeout(SERVICE_MESSAGE_RESPONSE_TIMEOUT_MS);
-        binding->SetDefaultWRMPConfig(gWRMPConfigService);
+        inParam.mSubscribeRequestParsed.mHandler->AcceptSubscribeRequest(sWDMfeature.mLivenessPolicy.SelectTimeout(
+            inParam.mSubscribeRequestParsed.mTimeoutSecMin, inParam.mSubscribeRequestParsed.mTimeoutSecMax));
+        break;
+    }
 
-        inParam.mSubscribeRequestParsed.mHandler->AcceptSubscribeRequest(
-            inParam.mSubscribeRequestParsed.mTimeoutSecMin);
+    case SubscriptionHandler::kEvent_OnExchangeStart:
+    {
+        // Once the counter-subscription is established, its exchanges carry notifies.  The
+        // handler does not use the WRM ack callback, so it is borrowed to time the round trip.
+        if (inParam.mExchangeStart.mHandler == sWDMfeature.mServiceCounterSubHandler &&
+            sWDMfeature.mIsServiceCounterSubEstablished)
+        {
+            sWDMfeature.mNotifyStartMS            = System::Platform::Layer::GetClock_MonotonicMS();
+            sWDMfeature.mNotifyRetransTimeoutMS   = sWDMfeature.mServiceRtt.GetRetransTimeoutMS();
+            inParam.mExchangeStart.mEC->OnAckRcvd = HandleNotifyAck;
+            sWDMfeature.mEventOffload.OnNotifyStart();
+        }
         break;
     }
 
@@ -259,6 +696,14 @@ void WDMFeature::HandleInboundSubscriptionEvent(void *
             EFR32_LOG("Inbound service counter-subscription established");
 
             sWDMfeature.mIsServiceCounterSubEstablished = true;
+            sWDMfeature.mSubscriptionMetrics.OnCounterSubscriptionEstablished();
+        }
+        else if (LocalSubscriber *subscriber =
+                     sWDMfeature.FindLocalSubscriber(inParam.mSubscriptionEstablished.mHandler))
+        {
+            EFR32_LOG("Inbound subscription from node %016" PRIX64 " established", subscriber->NodeId);
+
+            subscriber->IsEstablished = true;
         }
         break;
     }
@@ -276,6 +721,23 @@ void WDMFeature::HandleInboundSubscriptionEvent(void *
 
             sWDMfeature.mServiceCounterSubHandler       = NULL;
             sWDMfeature.mIsServiceCounterSubEstablished = false;
+
+            if (inParam.mSubscriptionTerminated.mReason == WEAVE_ERROR_MESSAGE_NOT_ACKNOWLEDGED &&
+                sWDMfeature.mServiceRtt.OnRetransmitFailure())
+            {
+                sWDMfeature.ApplyServiceWRMPConfig();
+            }
+
+            sWDMfeature.mSubscriptionMetrics.OnCounterSubscriptionTerminated(
+                inParam.mSubscriptionTerminated.mReason, inParam.mSubscriptionTerminated.mStatusProfileId,
+                inParam.mSubscriptionTerminated.mStatusCode);
+        }
+        else if (LocalSubscriber *subscriber =
+                     sWDMfeature.FindLocalSubscriber(inParam.mSubscriptionTerminated.mHandler))
+        {
+            EFR32_LOG("Inbound subscription from node %016" PRIX64 " terminated: %s", subscriber->NodeId, termDesc);
+
+            subscriber->Handler = NULL;
         }
         break;
     }
@@ -295,16 +757,23 @@ void WDMFeature::HandleOutboundServiceSubscriptionEvent(void *
     {
     case SubscriptionClient::kEvent_OnSubscribeRequestPrepareNeeded:
     {
+        // The subscription client adds a version list built from the sinks' data versions,
+        // which are restored from NVM3 at boot, so the service only resends changed traits.
+        // mVersionedPathList selects schema version ranges, which are not needed here.
         outParam.mSubscribeRequestPrepareNeeded.mPathList                  = &(sWDMfeature.mServiceSinkTraitPaths[0]);
-        outParam.mSubscribeRequestPrepareNeeded.mPathListSize              = 1;
+        outParam.mSubscribeRequestPrepareNeeded.mPathListSize              = kSinkHandle_Max;
         outParam.mSubscribeRequestPrepareNeeded.mVersionedPathList         = NULL;
         outParam.mSubscribeRequestPrepareNeeded.mNeedAllEvents             = false;
         outParam.mSubscribeRequestPrepareNeeded.mLastObservedEventList     = NULL;
         outParam.mSubscribeRequestPrepareNeeded.mLastObservedEventListSize = 0;
-        outParam.mSubscribeRequestPrepareNeeded.mTimeoutSecMin             = SERVICE_LIVENESS_TIMEOUT_SEC;
-        outParam.mSubscribeRequestPrepareNeeded.mTimeoutSecMax             = SERVICE_LIVENESS_TIMEOUT_SEC;
 
-        EFR32_LOG("Sending outbound service subscribe request (path count 1)");
+        sWDMfeature.mLivenessPolicy.GetRequestRange(outParam.mSubscribeRequestPrepareNeeded.mTimeoutSecMin,
+                                                    outParam.mSubscribeRequestPrepareNeeded.mTimeoutSecMax);
+
+        EFR32_LOG("Sending outbound service subscribe request (path count %d, settings version %s)", kSinkHandle_Max,
+                  sWDMfeature.mBoltLockSettingsTraitSink.IsVersionValid() ? "known" : "unknown");
+
+        sWDMfeature.mSubscriptionMetrics.OnSubscribeRequest();
 
         break;
     }
@@ -312,6 +781,18 @@ void WDMFeature::HandleOutboundServiceSubscriptionEvent(void *
         EFR32_LOG("Outbound service subscription established (sub id %016" PRIX64 ")",
                   inParam.mSubscriptionEstablished.mSubscriptionId);
         sWDMfeature.mIsSubToServiceEstablished = true;
+        sWDMfeature.mSubscriptionMetrics.OnSubscriptionEstablished();
+        sWDMfeature.mResubscribeBackoff.Reset();
+        sWDMfeature.mServiceSession.OnServiceSubscriptionEstablished();
+
+        if (sWDMfeature.mLivenessPolicy.GetStablePeriodMS() != 0)
+        {
+            SystemLayer.StartTimer(sWDMfeature.mLivenessPolicy.GetStablePeriodMS(), HandleLivenessStableTimer, NULL);
+        }
+        break;
+
+    case SubscriptionClient::kEvent_OnNotificationProcessed:
+        sWDMfeature.mServiceSession.Checkpoint();
         break;
 
     case SubscriptionClient::kEvent_OnSubscriptionTerminated:
@@ -322,6 +803,33 @@ void WDMFeature::HandleOutboundServiceSubscriptionEvent(void *
                       : ErrorStr(inParam.mSubscriptionTerminated.mReason));
 
         sWDMfeature.mIsSubToServiceEstablished = false;
+        SystemLayer.CancelTimer(HandleLivenessStableTimer, NULL);
+
+        // A renewal aborts the subscription itself; that must not count against the liveness
+        // timeout, the round-trip estimate, the persisted session or the metrics.
+        if (sWDMfeature.mIsRenewingServiceSub)
+        {
+            break;
+        }
+
+        sWDMfeature.mServiceSession.OnSessionFailed(inParam.mSubscriptionTerminated.mReason);
+
+        if (inParam.mSubscriptionTerminated.mReason == WEAVE_ERROR_MESSAGE_NOT_ACKNOWLEDGED &&
+            sWDMfeature.mServiceRtt.OnRetransmitFailure())
+        {
+            sWDMfeature.ApplyServiceWRMPConfig();
+        }
+
+        // Losing connectivity says nothing about the liveness timeout.
+        if (ConnectivityMgr().HaveServiceConnectivity())
+        {
+            sWDMfeature.mLivenessPolicy.OnSubscriptionFailed();
+        }
+
+        sWDMfeature.mSubscriptionMetrics.OnSubscriptionTerminated(
+            inParam.mSubscriptionTerminated.mReason, inParam.mSubscriptionTerminated.mIsStatusCodeValid,
+            inParam.mSubscriptionTerminated.mStatusProfileId, inParam.mSubscriptionTerminated.mStatusCode,
+            inParam.mSubscriptionTerminated.mWillRetry);
         break;
 
     default:
@@ -335,19 +843,61 @@ void WDMFeature::PlatformEventHandler(const WeaveDeviceEvent *event, intptr_t ar
     bool serviceSubShouldBeActivated =
         (ConnectivityMgr().HaveServiceConnectivity() && ConfigurationMgr().IsPairedToAccount());
 
+    // A phone connecting over BLE is local activity too.
+    if (event->Type == DeviceEventType::kWoBLEConnectionEstablished)
+    {
+        AsyncPrewarmServiceSession(0);
+    }
+
+    // Settings, the settings data version and the service session belong to the pairing
+    // the device is leaving.  A re-pair must not find them.
+    if ((event->Type == DeviceEventType::kFabricMembershipChange && !event->FabricMembershipChange.IsMemberOfFabric) ||
+        (event->Type == DeviceEventType::kAccountPairingChange && !event->AccountPairingChange.IsPairedToAccount))
+    {
+        sWDMfeature.mServiceSession.OnPairingRemoved();
+
+        if (AppNvmStore::EraseAll() != WEAVE_NO_ERROR)
+        {
+            EFR32_LOG("Failed to erase application records");
+        }
+    }
+
+    sWDMfeature.mSubscriptionMetrics.OnServiceConnectivityChange(serviceSubShouldBeActivated);
+
     // If we should be activated and we are not, initiate subscription
     if (serviceSubShouldBeActivated == true && sWDMfeature.mIsSubToServiceActivated == false)
     {
         sWDMfeature.InitiateSubscriptionToService();
         sWDMfeature.mIsSubToServiceActivated = true;
     }
-    // If we should be activated and we already are, but not established and not in progress
-    else if (serviceSubShouldBeActivated && sWDMfeature.mIsSubToServiceActivated &&
-             !sWDMfeature.mIsSubToServiceEstablished && !sWDMfeature.mServiceSubClient->IsInProgressOrEstablished())
+    // If connectivity has just come back and the subscription is waiting to retry, retry soon
+    else if (serviceSubShouldBeActivated && !sWDMfeature.mWasServiceSubActivatable &&
+             sWDMfeature.mIsSubToServiceActivated && !sWDMfeature.mIsSubToServiceEstablished &&
+             !sWDMfeature.mServiceSubClient->IsInProgressOrEstablished())
     {
-        // Connectivity might have just come back again. Reset Resubscribe Interval
+        sWDMfeature.mResubscribeBackoff.Reset();
         sWDMfeature.mServiceSubClient->ResetResubscribe();
     }
+
+    sWDMfeature.mWasServiceSubActivatable = serviceSubShouldBeActivated;
+}
+
+void WDMFeature::HandleResubscribePolicy(void *const                          aAppState,
+                                         SubscriptionClient::ResubscribeParam &aInParam,
+                                         uint32_t &                           aOutIntervalMsec)
+{
+    // Without connectivity, retrying only wakes the radio.  Wait; the retry is brought
+    // forward when connectivity returns.
+    if (!ConnectivityMgr().HaveServiceConnectivity())
+    {
+        aOutIntervalMsec = APP_RESUBSCRIBE_MAX_INTERVAL_MS;
+    }
+    else
+    {
+        aOutIntervalMsec = sWDMfeature.mResubscribeBackoff.NextIntervalMS();
+    }
+
+    EFR32_LOG("Service resubscribe attempt %" PRIu32 " in %" PRIu32 " ms", aInParam.mNumRetries + 1, aOutIntervalMsec);
 }
 
 WEAVE_ERROR WDMFeature::Init()
@@ -355,15 +905,48 @@ WEAVE_ERROR WDMFeature::Init()
     WEAVE_ERROR err;
     Binding *   binding;
 
+    mSubscriptionMetrics.Init();
+    mServiceSession.Init(kServiceEndpoint_Core_Router);
+    mResubscribeBackoff.Init(APP_RESUBSCRIBE_BASE_INTERVAL_MS, APP_RESUBSCRIBE_MAX_INTERVAL_MS, GetRandU32);
+    mEventOffload.Init();
+    mTrafficScheduler.Init(HandleTrafficScheduling);
+
+    {
+        ConnectivityManager::ThreadPollingConfig pollingConfig;
+
+        ConnectivityMgr().GetThreadPollingConfig(pollingConfig);
+        mNotifyBatchWindowMS = APP_NOTIFY_BATCH_POLL_PERIODS * pollingConfig.InactivePollingIntervalMS;
+    }
+    mLivenessPolicy.Init(SERVICE_MESSAGE_RESPONSE_TIMEOUT_MS);
+    mServiceRtt.Init(SERVICE_WRM_INITIAL_RETRANS_TIMEOUT_MS, SERVICE_WRM_MIN_RETRANS_TIMEOUT_MS,
+                     SERVICE_WRM_MAX_RETRANS_TIMEOUT_MS);
+
     err = mPublisherLock.Init();
 
     VerifyOrExit(err == WEAVE_NO_ERROR, err = WEAVE_ERROR_NO_MEMORY);
     PlatformMgr().AddEventHandler(PlatformEventHandler);
 
-    mServiceSourceTraitCatalog.AddAt(0, &mBoltLockTraitSource, kSourceHandle_BoltLockTrait);
-    mServiceSourceTraitCatalog.AddAt(0, &mDeviceIdentityTraitSource, kSourceHandle_DeviceIdentityTrait);
+#define WDM_ADD_SOURCE(NAME, TYPE, MEMBER, INSTANCE)                                                                   \
+    err = mServiceSourceTraitCatalog.AddAt(INSTANCE, &MEMBER, kSourceHandle_##NAME);                                   \
+    SuccessOrExit(err);
+#define WDM_ADD_SINK(NAME, TYPE, MEMBER, INSTANCE)                                                                     \
+    err = mServiceSinkTraitCatalog.AddAt(INSTANCE, &MEMBER, kSinkHandle_##NAME);                                       \
+    SuccessOrExit(err);
+
+    WDM_SOURCE_TRAITS(WDM_ADD_SOURCE)
+    WDM_SINK_TRAITS(WDM_ADD_SINK)
+
+#undef WDM_ADD_SINK
+#undef WDM_ADD_SOURCE
+
+    // Not fatal: without persisted settings the service simply sends the full trait.
+    mBoltLockSettingsTraitSink.Init();
+
+    // Not fatal either: the identity is then read from the configuration manager on each request.
+    mDeviceIdentityTraitSource.Init();
 
-    mServiceSinkTraitCatalog.AddAt(0, &mBoltLockSettingsTraitSink, kSinkHandle_BoltLockSettingsTrait);
+    // Nor is this: the metrics are then only published to new subscriptions.
+    mSubscriptionDiagnosticsTraitSource.Init();
 
     for (uint8_t handle = 0; handle < kSinkHandle_Max; handle++)
     {
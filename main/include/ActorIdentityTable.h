@@ -0,0 +1,87 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/**
+ *    @file
+ *      A fixed-capacity interning table for the originator and agent
+ *      identities (weave.common.ResourceId byte strings) of lock actors.
+ *
+ */
+
+#ifndef ACTOR_IDENTITY_TABLE_H
+#define ACTOR_IDENTITY_TABLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "AppConfig.h"
+
+class ActorIdentityTable
+{
+public:
+    typedef uint8_t Index;
+
+    enum
+    {
+        kInvalidIndex = 0xFF,
+        kMaxIdLength  = APP_ACTOR_ID_MAX_LENGTH,
+    };
+
+    void Init(void);
+
+    // Returns the index of an identity, adding it to the table if it is not already present.
+    // The returned index carries one reference, which the caller must eventually Release().
+    // Returns kInvalidIndex if the identity is too long, or if every entry is referenced.
+    //
+    // Intern() must only be called from the Weave task.  Release() may be called from any task.
+    Index Intern(const uint8_t *aId, uint32_t aLen);
+    void  Release(Index aIndex);
+
+    // Returns the bytes of an identity.  Only valid while the caller holds a reference.
+    const uint8_t *Get(Index aIndex, uint8_t &aLen) const;
+
+private:
+    friend ActorIdentityTable &ActorIds(void);
+
+    struct Entry
+    {
+        uint8_t  Id[kMaxIdLength];
+        uint8_t  Len;
+        uint8_t  RefCount;
+        Index    Next; // Next entry in the same hash bucket, or in the free list.
+        uint32_t Hash;
+    };
+
+    static uint32_t Hash(const uint8_t *aId, uint32_t aLen);
+
+    Index AllocEntry(void);
+    void  Unlink(Index aIndex);
+
+    Entry mEntries[APP_ACTOR_ID_TABLE_SIZE];
+    Index mBuckets[APP_ACTOR_ID_TABLE_BUCKETS];
+    Index mFreeList;
+
+    static ActorIdentityTable sActorIds;
+};
+
+inline ActorIdentityTable &ActorIds(void)
+{
+    return ActorIdentityTable::sActorIds;
+}
+
+#endif // ACTOR_IDENTITY_TABLE_H
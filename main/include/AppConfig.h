@@ -45,6 +45,126 @@
 // state to another.
 #define ACTUATOR_MOVEMENT_PERIOS_MS 2000
 
+// Number of recently processed lock commands remembered so that a retry of the same
+// command (same source node, command type, expiry time and must-be version) can be
+// answered without actuating the bolt again.
+#define APP_COMMAND_RESPONSE_CACHE_SIZE 4
+
+// Log BoltActuatorStateChangeEvents using the compact encoding (packed enums, no
+// null fields, delta-encoded system timestamps) instead of the schema encoding.
+// The compact event is a separate event structure type that the service must
+// understand, so it is disabled by default.
+#ifndef APP_COMPACT_BOLT_LOCK_EVENTS
+#define APP_COMPACT_BOLT_LOCK_EVENTS 0
+#endif
+
+// Answer BoltLockChangeRequest commands when the bolt has finished moving, with
+// the final state and the time taken, rather than as soon as the request is
+// queued.  A command that has not completed within the timeout is answered with
+// a Timeout status report.
+#ifndef APP_DEFERRED_COMMAND_RESPONSE
+#define APP_DEFERRED_COMMAND_RESPONSE 0
+#endif
+#define APP_DEFERRED_COMMAND_RESPONSE_TIMEOUT_MS (3 * ACTUATOR_MOVEMENT_PERIOS_MS)
+
+// Worst-case drift of the monotonic clock relative to UTC, used when checking
+// command expiry times while the real-time clock is not synchronized.
+#define APP_CLOCK_DRIFT_PPM 100
+#define APP_CLOCK_DRIFT_BASE_ALLOWANCE_MS 1000
+
+// The UTC time, or a lower bound on it, is persisted at this interval (96 writes a
+// day), as a lower bound on the time after a reboot.  Until the clock is
+// synchronized again, commands are only accepted if they expire within the horizon
+// of that bound, and after the previous boot's last checkpoint plus one interval
+// plus the horizon, which is the latest expiry a command that boot received can
+// carry.  Commands with a longer lifetime than the horizon may be replayed before
+// the first sync after a reboot.  Right after a reboot, commands are answered with
+// NotTimeSyncedYet until the clock is synchronized or the device has run for
+// about one interval.
+#define APP_CLOCK_CHECKPOINT_INTERVAL_MS (15 * 60 * 1000) // 15 minutes
+#define APP_CLOCK_CHECKPOINT_HORIZON_MS (2 * 60 * 1000)   // 2 minutes
+
+// Capacity of the table of lock actor originator/agent identities.  Each
+// distinct identity is stored once, however many actions refer to it.
+#define APP_ACTOR_ID_TABLE_SIZE 8
+#define APP_ACTOR_ID_TABLE_BUCKETS 8
+#define APP_ACTOR_ID_MAX_LENGTH 16
+
+
+// Number of distinct subscription termination reasons (status codes or local
+// errors) counted by the subscription metrics; further reasons are only counted
+// in total.  The metrics are republished in the SubscriptionDiagnosticsTrait at
+// this interval.
+#define APP_SUBSCRIPTION_METRICS_MAX_TERMINATION_REASONS 4
+#define APP_SUBSCRIPTION_DIAGNOSTICS_PUBLISH_INTERVAL_MS (60 * 60 * 1000) // 1 hour
+
+// Liveness timeout of the service subscriptions (see SubscriptionLivenessPolicy.h).
+// It ranges from the minimum, while the subscription is unstable, to the maximum,
+// which bounds the time taken to detect a lost subscription.
+#define APP_SUBSCRIPTION_LIVENESS_MIN_SEC 60
+#define APP_SUBSCRIPTION_LIVENESS_MAX_SEC (16 * 60) // 16 minutes
+#define APP_SUBSCRIPTION_LIVENESS_STABLE_PERIODS 4
+#define APP_SUBSCRIPTION_LIVENESS_POLL_PERIODS 4
+
+// Number of local fabric devices (hubs, keypads) that may subscribe to the lock's
+// traits at the same time, one subscription each.  Requests must be encrypted and
+// may only name the BoltLockTrait and DeviceIdentityTrait.
+#define APP_MAX_LOCAL_SUBSCRIBERS 2
+
+// Trait changes that are not urgent are held back and sent together, in one notify
+// burst, after this many inactive Thread polling intervals or with the next urgent
+// change, whichever comes first.  Changes of the locked state are urgent.  The window
+// covers a bolt movement, so the start and end of a lock cycle go out together.
+#ifndef APP_NOTIFY_BATCHING
+#define APP_NOTIFY_BATCHING 1
+#endif
+#define APP_NOTIFY_BATCH_POLL_PERIODS 3
+
+// Estimated fill level of an event buffer, from the events logged since the last
+// acknowledged offload, at which the events are offloaded straight away instead of
+// with the next notify burst (see EventOffloadController.h).  The mark is lower while
+// the device has service connectivity.  Event sizes are measured as events are
+// logged; the estimate is only used until the first event is measured.
+#define APP_EVENT_OFFLOAD_HIGH_WATER_PERCENT 75
+#define APP_EVENT_OFFLOAD_CONNECTED_HIGH_WATER_PERCENT 50
+#define APP_EVENT_OFFLOAD_EVENT_SIZE_ESTIMATE 32
+
+// Retry intervals of the service subscription (see ResubscribeBackoff.h).  While
+// there is no service connectivity, retries wait for the maximum interval, and are
+// brought forward when connectivity returns.
+#define APP_RESUBSCRIBE_BASE_INTERVAL_MS 2000
+#define APP_RESUBSCRIBE_MAX_INTERVAL_MS (10 * 60 * 1000) // 10 minutes
+
+// Persist the shared CASE session with the service in NVM3 and resume it after a
+// reboot instead of running a new CASE handshake (see ServiceSessionStore.h).  The
+// session key is held in flash, wrapped under a key derived from the device private
+// key, so this is disabled by default.  The record is rewritten each time the send
+// counter advances by half the margin, and the restored counter skips the full margin.
+// It is also rewritten each time the receive counter advances by a block; messages
+// received since the last checkpoint can be replayed after a reboot, so the block is
+// small.  The counters are checked after service traffic and at the given interval.
+#ifndef APP_PERSIST_SERVICE_SESSION
+#define APP_PERSIST_SERVICE_SESSION 0
+#endif
+#define APP_SERVICE_SESSION_MAX_RESUMES 8
+#define APP_SERVICE_SESSION_MSG_ID_MARGIN 65536
+#define APP_SERVICE_SESSION_RCVD_MSG_ID_BLOCK 16
+#define APP_SERVICE_SESSION_CHECKPOINT_INTERVAL_MS (60 * 1000) // 1 minute
+
+// Local activity (the lock button, a BLE connection) brings forward a pending
+// service resubscribe, so that the session and subscriptions are up before a remote
+// interaction needs them.  At most this many pre-warms are started per hour.
+#define APP_SERVICE_PREWARM_MAX_PER_HOUR 4
+
+// Outbound traffic is served in class order: lock command responses and lock-state
+// notifies, then event offloads, then software update image blocks (see
+// TrafficScheduler.h).  A lock command opens an interactive window, held for long
+// enough to cover the bolt movement and its notify, during which batched event
+// offloads wait and an image download is preempted, at most this many times per
+// download.
+#define APP_TRAFFIC_INTERACTIVE_HOLD_MS (2 * ACTUATOR_MOVEMENT_PERIOS_MS)
+#define APP_TRAFFIC_MAX_BULK_PREEMPTIONS 4
+
 // ---- Lock Example SWU Config ----
 #define SWU_INTERVAl_WINDOW_MIN_MS (23 * 60 * 60 * 1000) // 23 hours
 #define SWU_INTERVAl_WINDOW_MAX_MS (24 * 60 * 60 * 1000) // 24 hours
@@ -30,6 +30,7 @@ struct AppEvent
         kEventType_Timer,
         kEventType_Lock,
         kEventType_Install,
+        kEventType_LockConfig,
     };
 
     uint16_t Type;
@@ -49,7 +50,14 @@ struct AppEvent
         {
             uint8_t Action;
             int32_t Actor;
+            uint8_t Originator; // ActorIdentityTable index, holding one reference.
+            uint8_t Agent;      // ActorIdentityTable index, holding one reference.
         } LockEvent;
+        struct
+        {
+            uint8_t  AutoRelockOn;
+            uint32_t AutoRelockDuration;
+        } LockConfigEvent;
     };
 
     EventHandler Handler;
@@ -0,0 +1,61 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/**
+ *    @file
+ *      Persistent storage of application records in the default NVM3 instance.
+ *
+ */
+
+#ifndef APP_NVM_STORE_H
+#define APP_NVM_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+
+class AppNvmStore
+{
+public:
+    // NVM3 object keys owned by the application.  These live in their own key range,
+    // apart from the ranges used by the Weave device layer and OpenThread, so the device
+    // layer's factory reset does not erase them; EraseAll() does.
+    enum Key
+    {
+        kKeyBase = 0x0C000,
+
+        kKey_ClockCheckpoint  = kKeyBase + 0x01,
+        kKey_BoltLockSettings = kKeyBase + 0x02,
+        kKey_ServiceSession   = kKeyBase + 0x03,
+
+        kKey_Last = kKey_ServiceSession,
+    };
+
+    // Reads a record, which must be exactly aLen bytes long.  Returns
+    // WEAVE_DEVICE_ERROR_CONFIG_NOT_FOUND if the record does not exist.
+    static WEAVE_ERROR Read(Key aKey, void *aBuf, size_t aLen);
+    static WEAVE_ERROR Write(Key aKey, const void *aData, size_t aLen);
+    static WEAVE_ERROR Delete(Key aKey);
+
+    // Deletes every application record.  Called on factory reset, and when the device
+    // leaves its fabric or account, since the records belong to that pairing.
+    static WEAVE_ERROR EraseAll(void);
+};
+
+#endif // APP_NVM_STORE_H
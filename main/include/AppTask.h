@@ -39,8 +39,8 @@ public:
     int         StartAppTask();
     static void AppTaskMain(void *pvParameter);
 
-    void PostLockActionRequest(int32_t aActor, BoltLockManager::Action_t aAction);
-    void PostEvent(const AppEvent *event);
+    bool PostLockActionRequest(int32_t aActor, uint8_t aOriginator, uint8_t aAgent, BoltLockManager::Action_t aAction);
+    bool PostEvent(const AppEvent *event);
 
     void ButtonEventHandler(uint8_t btnIdx, uint8_t btnAction);
 
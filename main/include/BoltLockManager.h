@@ -48,8 +48,11 @@ public:
 
     int  Init();
     bool IsUnlocked();
-    void EnableAutoRelock(bool aOn);
-    void SetAutoLockDuration(uint32_t aDurationInSecs);
+    // Applies both auto-relock settings in one step, reprogramming the auto-relock timer at
+    // most once.  SetAutoRelockConfig() must be called on the app task; PostAutoRelockConfig()
+    // may be called from any task.
+    void SetAutoRelockConfig(bool aOn, uint32_t aDurationInSecs);
+    void PostAutoRelockConfig(bool aOn, uint32_t aDurationInSecs);
     bool IsActionInProgress();
     bool InitiateAction(int32_t aActor, Action_t aAction);
 
@@ -74,6 +77,7 @@ private:
     static void TimerEventHandler(TimerHandle_t xTimer);
     static void AutoReLockTimerEventHandler(AppEvent *aEvent);
     static void ActuatorMovementTimerEventHandler(AppEvent *aEvent);
+    static void AutoRelockConfigEventHandler(AppEvent *aEvent);
 
     static BoltLockManager sLock;
 };
@@ -0,0 +1,90 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/**
+ *    @file
+ *      Evaluates WDM command expiry times, including while the real-time
+ *      clock is not synchronized.
+ *
+ */
+
+#ifndef COMMAND_EXPIRY_CHECKER_H
+#define COMMAND_EXPIRY_CHECKER_H
+
+#include <stdint.h>
+
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+
+class CommandExpiryChecker
+{
+public:
+    enum Result
+    {
+        kResult_NotExpired = 0,
+        kResult_Expired,
+        kResult_TimeUnknown,
+    };
+
+    WEAVE_ERROR Init(void);
+
+    // Compares an expiry time against the best available estimate of the current UTC time:
+    //
+    //  - the real-time clock, while it is synchronized;
+    //  - the monotonic clock plus the UTC offset recorded at the last sync in this boot, widened
+    //    by the worst-case clock drift since that sync;
+    //  - after a reboot, before the first sync: the UTC time last persisted while synchronized
+    //    plus the time since boot.  This is a lower bound on the current time (the device may
+    //    have been powered off for a while).  Commands that have certainly expired are rejected.
+    //    The time is unknown for commands expiring more than APP_CLOCK_CHECKPOINT_HORIZON_MS
+    //    beyond the bound, and for commands the previous boot could have received, which
+    //    may be replays.  The checkpoint is rewritten every APP_CLOCK_CHECKPOINT_INTERVAL_MS
+    //    while any lower bound on the time is known.
+    Result Check(int64_t aExpiryTimeMicroSecond);
+
+private:
+    friend CommandExpiryChecker &ExpiryChecker(void);
+
+    struct ClockCheckpoint
+    {
+        uint64_t UtcTimeMS;
+    };
+
+    static void HandlePlatformEvent(const ::nl::Weave::DeviceLayer::WeaveDeviceEvent *event, intptr_t arg);
+    static void HandleCheckpointTimer(::nl::Weave::System::Layer *aLayer, void *aAppState,
+                                      ::nl::Weave::System::Error aError);
+    static void AsyncStartCheckpointTimer(intptr_t arg);
+
+    void RecordSync(bool aPersist);
+    bool GetLowerBound(uint64_t & aUtcTimeMS) const;
+    void PersistCheckpoint(uint64_t aUtcTimeMS);
+
+    int64_t  mUtcOffsetMS;      // UTC minus monotonic time, as of the last sync in this boot.
+    uint64_t mSyncMonotonicMS;  // Monotonic time of the last sync in this boot.
+    uint64_t mBootLowerBoundMS; // UTC time of the last checkpoint before this boot.
+    bool     mHaveOffset;
+    bool     mHaveBootLowerBound;
+
+    static CommandExpiryChecker sExpiryChecker;
+};
+
+inline CommandExpiryChecker &ExpiryChecker(void)
+{
+    return CommandExpiryChecker::sExpiryChecker;
+}
+
+#endif // COMMAND_EXPIRY_CHECKER_H
@@ -0,0 +1,93 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/**
+ *    @file
+ *      A small fixed-size cache of recently processed WDM commands, used to
+ *      answer retries of a command without re-executing it.
+ *
+ *      A redelivery of the same command message never reaches the data source:
+ *      the exchange layer acknowledges and drops it as a duplicate.  A retry by
+ *      the sender arrives in a new message, with a new message id, so commands
+ *      are identified by what the retry keeps: the source node, the command type,
+ *      the expiry time and the must-be version.  The expiry time, in microseconds,
+ *      is set once when the command is created, which tells a retry from a new
+ *      command of the same type.  Commands without an expiry time cannot be told
+ *      apart and are not cached.
+ *
+ */
+
+#ifndef COMMAND_RESPONSE_CACHE_H
+#define COMMAND_RESPONSE_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "AppConfig.h"
+
+class CommandResponseCache
+{
+public:
+    struct Key
+    {
+        uint64_t PeerNodeId;
+        uint64_t CommandType;
+        uint64_t MustBeVersion;
+        int64_t  ExpiryTimeMicroSecond;
+        bool     IsMustBeVersionValid;
+
+        bool Matches(const Key &aOther) const;
+    };
+
+    struct Entry
+    {
+        Key      CommandKey;
+        uint64_t ResponseVersion;
+        uint32_t StatusProfileId;
+        uint16_t StatusCode;
+        bool     IsSuccess;
+        bool     InUse;
+    };
+
+    void Init(void);
+
+    // Builds the key of a command.  Returns false if the command carries no expiry time,
+    // in which case it is neither looked up nor cached.
+    static bool MakeKey(uint64_t aPeerNodeId, uint64_t aCommandType, bool aIsExpiryTimeValid,
+                        int64_t aExpiryTimeMicroSecond, bool aIsMustBeVersionValid, uint64_t aMustBeVersion, Key &aKey);
+
+    // Returns the cached outcome of a previously processed command, or NULL if the
+    // command has not been seen before.  Every call counts as one lookup.
+    const Entry *Find(const Key &aKey);
+
+    void AddSuccess(const Key &aKey, uint64_t aResponseVersion);
+    void AddError(const Key &aKey, uint32_t aStatusProfileId, uint16_t aStatusCode);
+
+    uint32_t GetLookupCount(void) const { return mLookupCount; }
+    uint32_t GetHitCount(void) const { return mHitCount; }
+
+private:
+    Entry *AllocEntry(const Key &aKey);
+
+    Entry    mEntries[APP_COMMAND_RESPONSE_CACHE_SIZE];
+    uint8_t  mNextEntry;
+    uint32_t mLookupCount;
+    uint32_t mHitCount;
+};
+
+#endif // COMMAND_RESPONSE_CACHE_H
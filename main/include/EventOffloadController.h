@@ -0,0 +1,116 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/**
+ *    @file
+ *      Decides when the event buffers are offloaded over WDM, from how full they
+ *      are.
+ *
+ */
+
+#ifndef EVENT_OFFLOAD_CONTROLLER_H
+#define EVENT_OFFLOAD_CONTROLLER_H
+
+#include <stdint.h>
+
+#include <Weave/Profiles/data-management/Current/DataManagement.h>
+
+#include "AppConfig.h"
+
+/**
+ *  Tracks, for each importance buffer, the events logged since the last offload
+ *  the service acknowledged.  Their size is the average measured from the bytes
+ *  the logger has written per event logged (APP_EVENT_OFFLOAD_EVENT_SIZE_ESTIMATE
+ *  until the first event), which gives a fill level against the buffer size.
+ *
+ *  Events are logged as urgent only together with an urgent notify, which goes out
+ *  at once in any case.  Every other event is followed by a batched notify request,
+ *  which consults the controller: below the high-water mark the events wait for the
+ *  next notify burst, and a buffer at its high-water mark asks for an immediate
+ *  burst, before the logger starts evicting events.  The mark is lower while the
+ *  device has service connectivity, since an offload then goes straight out.  The
+ *  logger's own byte-threshold offload (WEAVE_CONFIG_EVENT_LOGGING_BYTE_THRESHOLD)
+ *  is set no lower than the buffer sizes, so it does not fire before the marks.
+ *
+ *  When a notify to the service starts, the last event logged at each level is
+ *  noted; once the notify is acknowledged, events up to those are offloaded.  A
+ *  notify that fails offloads nothing.  The engine may split a long backlog over
+ *  several notifies, so an acknowledged notify can be credited with events that go
+ *  in the next one.  Events the logger evicted before they were acknowledged are
+ *  counted as lost, as are offload batch sizes.  Only accessed on the Weave task.
+ */
+class EventOffloadController
+{
+public:
+    enum
+    {
+        kNumBuffers = ::nl::Weave::Profiles::DataManagement_Current::kImportanceType_Last -
+                      ::nl::Weave::Profiles::DataManagement_Current::kImportanceType_First + 1,
+    };
+
+    struct BufferStats
+    {
+        uint32_t Pending;     // Events logged and not yet offloaded.
+        uint8_t FillPercent;  // Estimated fill level of the pending events.
+        uint8_t MaxFillPercent;
+        uint32_t Evicted;     // Events lost before they were offloaded.
+    };
+
+    void Init(void);
+
+    // Returns true if a buffer has reached its high-water mark, so its events should be
+    // offloaded now rather than with the next batched burst.
+    bool ShouldOffloadNow(bool aHaveServiceConnectivity);
+
+    // Called as a notify to the service starts, and when the service acknowledges it.
+    void OnNotifyStart(void);
+    void OnNotifyAcked(void);
+
+    // Average encoded size of the events logged so far.
+    uint32_t GetAverageEventSize(void) const;
+
+    const BufferStats & GetBufferStats(uint8_t aBuffer) const { return mBuffers[aBuffer]; }
+
+    void Log(void) const;
+
+private:
+    void Update(void);
+
+    static uint32_t GetBufferSize(uint8_t aBuffer);
+
+    BufferStats mBuffers[kNumBuffers];
+
+    // Id of the first event in each buffer that has not been offloaded.
+    ::nl::Weave::Profiles::DataManagement_Current::event_id_t mNextEventId[kNumBuffers];
+
+    // Id following the last event in each buffer when the outstanding notify started.
+    ::nl::Weave::Profiles::DataManagement_Current::event_id_t mInFlightEventId[kNumBuffers];
+    bool mIsNotifyInFlight;
+
+    // Bytes written by the logger and events logged, for the average event size.
+    ::nl::Weave::Profiles::DataManagement_Current::event_id_t mLastLoggedEventId[kNumBuffers];
+    uint32_t mLastBytesWritten;
+    uint32_t mMeasuredBytes;
+    uint32_t mMeasuredEvents;
+
+    uint32_t mOffloads;
+    uint32_t mOffloadedEvents;
+    uint32_t mMaxBatchSize;
+};
+
+#endif // EVENT_OFFLOAD_CONTROLLER_H
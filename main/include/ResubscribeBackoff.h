@@ -0,0 +1,59 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/**
+ *    @file
+ *      Retry intervals for the service subscription.
+ *
+ */
+
+#ifndef RESUBSCRIBE_BACKOFF_H
+#define RESUBSCRIBE_BACKOFF_H
+
+#include <stdint.h>
+
+/**
+ *  Decorrelated jitter backoff: each interval is drawn uniformly from
+ *  [base, 3 x previous interval] and capped.  Devices that lose the service at the
+ *  same moment, as when a border router restarts, spread their retries out instead
+ *  of retrying in step, while each device still backs off roughly exponentially.
+ *
+ *  The random source is supplied by the caller, so the policy can be run on a host
+ *  to simulate a fleet of devices.
+ */
+class ResubscribeBackoff
+{
+public:
+    typedef uint32_t (*RandomFunct)(void);
+
+    void Init(uint32_t aBaseMS, uint32_t aCapMS, RandomFunct aRandom);
+
+    // Interval to wait before the next attempt.
+    uint32_t NextIntervalMS(void);
+
+    // Start again from the base interval, as when connectivity returns.
+    void Reset(void);
+
+private:
+    uint32_t mBaseMS;
+    uint32_t mCapMS;
+    uint32_t mPrevIntervalMS;
+    RandomFunct mRandom;
+};
+
+#endif // RESUBSCRIBE_BACKOFF_H
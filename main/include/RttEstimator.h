@@ -0,0 +1,73 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/**
+ *    @file
+ *      Round-trip time estimation for a WRM peer, used to derive its
+ *      retransmission timeout.
+ *
+ */
+
+#ifndef RTT_ESTIMATOR_H
+#define RTT_ESTIMATOR_H
+
+#include <stdint.h>
+
+/**
+ *  Estimates the round-trip time as in TCP (RFC 6298): a smoothed RTT and RTT
+ *  variance, giving a retransmission timeout of SRTT + 4 * RTTVAR clamped to
+ *  [min, max].
+ *
+ *  Karn's rule: a sample taken from a message that was retransmitted cannot be
+ *  matched to a transmission, so it is discarded.  A sample no shorter than the
+ *  timeout the message was sent with means a retransmission happened.  The
+ *  timeout is then backed off (doubled, up to the maximum) until a clean sample
+ *  is taken.
+ */
+class RttEstimator
+{
+public:
+    void Init(uint32_t aInitialTimeoutMS, uint32_t aMinTimeoutMS, uint32_t aMaxTimeoutMS);
+
+    // Round trip of a message sent while GetRetransTimeoutMS() returned aSentTimeoutMS.
+    // Returns true if the retransmission timeout changed.
+    bool AddSample(uint32_t aRoundTripMS, uint32_t aSentTimeoutMS);
+
+    // A message went unacknowledged after all its retransmissions.
+    bool OnRetransmitFailure(void);
+
+    uint32_t GetRetransTimeoutMS(void) const { return mRetransTimeoutMS; }
+    uint32_t GetSmoothedRttMS(void) const { return mSmoothedRtt8 / 8; }
+    uint32_t GetRttVarianceMS(void) const { return mRttVariance4 / 4; }
+    uint32_t GetSampleCount(void) const { return mSampleCount; }
+    uint32_t GetDiscardedSampleCount(void) const { return mDiscardedSampleCount; }
+
+private:
+    bool Backoff(void);
+    bool SetRetransTimeout(uint32_t aTimeoutMS);
+
+    uint32_t mSmoothedRtt8; // SRTT, scaled by 8.
+    uint32_t mRttVariance4; // RTTVAR, scaled by 4.
+    uint32_t mRetransTimeoutMS;
+    uint32_t mMinTimeoutMS;
+    uint32_t mMaxTimeoutMS;
+    uint32_t mSampleCount;
+    uint32_t mDiscardedSampleCount;
+};
+
+#endif // RTT_ESTIMATOR_H
@@ -0,0 +1,161 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/**
+ *    @file
+ *      Persists the shared CASE session with the service, so that it can be resumed
+ *      after a reboot without a new CASE handshake.
+ *
+ */
+
+#ifndef SERVICE_SESSION_STORE_H
+#define SERVICE_SESSION_STORE_H
+
+#include <stdint.h>
+
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+
+#include "AppConfig.h"
+
+/**
+ *  When the service binding becomes ready, the shared session's key, key id and
+ *  message counters are written to NVM3.  At boot the session is put back into the
+ *  fabric state.  The binding's shared CASE session lookup then finds it, and the
+ *  service exchanges start at once, without the certificate verification and ECDH of
+ *  a CASE handshake.
+ *
+ *  The session key is stored wrapped: it is encrypted with AES-128-CTR, and the whole
+ *  record is authenticated with HMAC-SHA256, under keys derived with HKDF-SHA256 from
+ *  the device private key.  A record copied to another device, or modified in flash,
+ *  is rejected.
+ *
+ *  The record is restored on the Weave task, which owns the fabric state.  Both message
+ *  counters are checkpointed in blocks, on the Weave task and never on the path of the
+ *  message that advanced them:
+ *
+ *    - The record is rewritten when the send counter passes the persisted value plus
+ *      half of APP_SERVICE_SESSION_MSG_ID_MARGIN.  The restored counter starts the full
+ *      margin beyond the persisted value, so message ids are never reused.
+ *    - The record is rewritten when the highest message id received passes the
+ *      persisted one by APP_SERVICE_SESSION_RCVD_MSG_ID_BLOCK.  The receive state is
+ *      restored with the key, so messages received before the last checkpoint are
+ *      rejected as duplicates after a reboot.  It cannot be restored ahead of the peer,
+ *      whose next messages would then be dropped, so up to one block of messages
+ *      received since the last checkpoint remains open to replay.
+ *
+ *  The counters are checked after each notification engine run, each notify received,
+ *  each command received (from scheduled work, once the command has been handled), and
+ *  every APP_SERVICE_SESSION_CHECKPOINT_INTERVAL_MS, which covers any other message.
+ *  If the record cannot be written, it is deleted instead.  The wrapping keys are
+ *  derived once, when they are first needed.
+ *
+ *  A record is resumed at most APP_SERVICE_SESSION_MAX_RESUMES times, and only on the
+ *  fabric it was captured on.  If the service has dropped the session, the peer
+ *  reports that the key was not found.  The record is then deleted, and the next
+ *  attempt falls back to a full CASE handshake.
+ *
+ *  Session establishment times are logged for resumed and full sessions.  Only
+ *  accessed on the Weave task.
+ */
+class ServiceSessionStore
+{
+public:
+    void Init(uint64_t aTerminatingNodeId);
+
+    // Events of the service binding.
+    void OnBindingPrepare(void);
+    void OnBindingReady(nl::Weave::Binding * aBinding);
+
+    // The service binding or subscription failed.
+    void OnSessionFailed(WEAVE_ERROR aReason);
+
+    // The device left its fabric or account.  The persisted session is no longer resumed.
+    void OnPairingRemoved(void);
+
+    // The first service subscription after boot is established.
+    void OnServiceSubscriptionEstablished(void);
+
+    // Rewrites the record if either message counter has crossed its checkpoint block.
+    void Checkpoint(void);
+
+    // A message was received under the key.  Schedules a checkpoint on the Weave task.
+    void OnMessageReceived(uint16_t aKeyId);
+
+private:
+    enum
+    {
+        kNonceLength         = 16, // AES-128-CTR initial counter block.
+        kEncKeyLength        = 16,
+        kMacKeyLength        = 32,
+        kTagLength           = 32,
+        kMaxPrivateKeyLength = 128,
+    };
+
+    struct PersistedSession
+    {
+        uint64_t FabricId;
+        uint32_t NextMsgId;
+        uint32_t MaxRcvdMsgId;
+        uint32_t RcvFlags;
+        uint16_t KeyId;
+        uint16_t AuthMode;
+        uint8_t EncType;
+        uint8_t ResumeCount;
+        uint8_t Nonce[kNonceLength];
+        uint8_t WrappedKey[sizeof(nl::Weave::WeaveEncryptionKey)];
+
+        // HMAC-SHA256 of all the fields above.
+        uint8_t Tag[kTagLength];
+    };
+
+    static void AsyncRestore(intptr_t arg);
+    static void AsyncCheckpoint(intptr_t arg);
+    static void HandleCheckpointTimer(nl::Weave::System::Layer * aLayer, void * aAppState,
+                                      nl::Weave::System::Error aError);
+
+    WEAVE_ERROR Restore(void);
+    WEAVE_ERROR Persist(const nl::Weave::WeaveSessionKey & aSessionKey, uint16_t aKeyId, uint8_t aResumeCount);
+    void Forget(void);
+    void StartCheckpointTimer(void);
+
+    WEAVE_ERROR GetWrappingKeys(void);
+    static void ComputeTag(const PersistedSession & aSession, const uint8_t * aMacKey, uint8_t * aTag);
+
+    uint8_t mEncKey[kEncKeyLength];
+    uint8_t mMacKey[kMacKeyLength];
+
+    uint64_t mTerminatingNodeId;
+    uint64_t mPrepareStartMS;
+    uint32_t mResumeSetupTotalMS;
+    uint32_t mResumeSetupCount;
+    uint32_t mFullSetupTotalMS;
+    uint32_t mFullSetupCount;
+    uint32_t mPersistedNextMsgId;
+    uint32_t mPersistedMaxRcvdMsgId;
+    uint16_t mRestoredKeyId;
+    uint16_t mPersistedKeyId;
+    uint8_t mResumeCount;
+    uint8_t mPersistedResumeCount;
+    bool mIsRestored;
+    bool mIsPreparing;
+    bool mIsFirstSubscriptionPending;
+    bool mHaveWrappingKeys;
+    bool mIsCheckpointScheduled;
+};
+
+#endif // SERVICE_SESSION_STORE_H
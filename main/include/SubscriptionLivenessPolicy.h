@@ -0,0 +1,77 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/**
+ *    @file
+ *      Chooses the liveness timeout of the service subscriptions.
+ *
+ */
+
+#ifndef SUBSCRIPTION_LIVENESS_POLICY_H
+#define SUBSCRIPTION_LIVENESS_POLICY_H
+
+#include <stdint.h>
+
+#include "AppConfig.h"
+
+/**
+ *  The target timeout starts at the floor and doubles each time the subscription
+ *  stays established for APP_SUBSCRIPTION_LIVENESS_STABLE_PERIODS timeouts, up to
+ *  APP_SUBSCRIPTION_LIVENESS_MAX_SEC, which bounds the time taken to notice a lost
+ *  subscription.  A failed subscription halves it again.
+ *
+ *  The floor is APP_SUBSCRIPTION_LIVENESS_MIN_SEC, raised if needed so that a
+ *  liveness check always has time for a full message exchange plus
+ *  APP_SUBSCRIPTION_LIVENESS_POLL_PERIODS of the Thread polling interval.
+ *
+ *  Only accessed on the Weave task.
+ */
+class SubscriptionLivenessPolicy
+{
+public:
+    void Init(uint32_t aResponseTimeoutMS);
+
+    // Range to offer in an outbound subscribe request: [floor, target].  The upper end is
+    // remembered as the worst case in effect for the new subscription.
+    void GetRequestRange(uint32_t &aTimeoutSecMin, uint32_t &aTimeoutSecMax);
+
+    // Timeout to accept from the range offered in an inbound (counter-)subscribe request.
+    uint32_t SelectTimeout(uint32_t aOfferedSecMin, uint32_t aOfferedSecMax) const;
+
+    // Time the subscription must stay up before the target next grows, or 0 at the maximum.
+    uint32_t GetStablePeriodMS(void) const;
+
+    // The subscription stayed up for the stable period.  Returns true if the target has
+    // grown enough that the subscription should be renewed to apply it.
+    bool OnStablePeriodElapsed(void);
+
+    // The subscription failed (not counting loss of connectivity or local teardown).
+    void OnSubscriptionFailed(void);
+
+    uint32_t GetTargetSec(void) const { return mTargetSec; }
+
+private:
+    void UpdateFloor(void);
+
+    uint32_t mResponseTimeoutMS;
+    uint32_t mFloorSec;
+    uint32_t mTargetSec;
+    uint32_t mRequestedSec; // Upper end of the range offered for the current subscription.
+};
+
+#endif // SUBSCRIPTION_LIVENESS_POLICY_H
@@ -0,0 +1,124 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef SUBSCRIPTION_METRICS_H
+#define SUBSCRIPTION_METRICS_H
+
+#include <stdint.h>
+
+#include <Weave/Core/WeaveCore.h>
+
+#include "AppConfig.h"
+
+/**
+ *  Timing and counter metrics for the service subscriptions, kept in fixed-size
+ *  storage.  Only accessed on the Weave task.
+ */
+class SubscriptionMetrics
+{
+public:
+    enum
+    {
+        kNumHistogramBuckets = 8,
+
+        // Bucket 0 of each histogram counts values below the base, bucket i values below
+        // (base << i), and the last bucket everything larger.
+        kSubscribeLatencyBaseMS = 500,
+        kNotifyRoundTripBaseMS  = 100,
+
+        kMaxTerminationReasons = APP_SUBSCRIPTION_METRICS_MAX_TERMINATION_REASONS,
+
+        // Profile id recorded for terminations caused by a local WEAVE_ERROR rather than a
+        // status report.
+        kLocalErrorProfileId = 0xFFFFFFFF,
+    };
+
+    enum ResubscribeCause
+    {
+        kResubscribeCause_Timeout = 0, // No response, or liveness timeout.
+        kResubscribeCause_StatusReport,
+        kResubscribeCause_Other,
+
+        kResubscribeCause_Max
+    };
+
+    struct Histogram
+    {
+        uint32_t Counts[kNumHistogramBuckets];
+    };
+
+    struct TerminationReason
+    {
+        uint32_t ProfileId;
+        uint16_t StatusCode;
+        uint32_t Count;
+    };
+
+    void Init(void);
+
+    // Called on every platform event; the latency clocks start when service connectivity
+    // is gained.
+    void OnServiceConnectivityChange(bool aHaveServiceConnectivity);
+
+    void OnSubscriptionEstablished(void);
+    void OnCounterSubscriptionEstablished(void);
+    void OnSubscriptionTerminated(WEAVE_ERROR aReason, bool aIsStatusCodeValid, uint32_t aStatusProfileId,
+                                  uint16_t aStatusCode, bool aWillRetry);
+    void OnCounterSubscriptionTerminated(WEAVE_ERROR aReason, uint32_t aStatusProfileId, uint16_t aStatusCode);
+    void OnSubscribeRequest(void);
+    void OnNotifyRoundTrip(uint32_t aRoundTripMS);
+
+    const Histogram &GetSubscribeLatency(void) const { return mSubscribeLatency; }
+    const Histogram &GetCounterSubscribeLatency(void) const { return mCounterSubscribeLatency; }
+    const Histogram &GetNotifyRoundTripTime(void) const { return mNotifyRoundTripTime; }
+    uint32_t         GetResubscribeAttempts(void) const { return mResubscribeAttempts; }
+    uint32_t         GetResubscribeCauseCount(ResubscribeCause aCause) const { return mResubscribeCauses[aCause]; }
+    uint8_t          GetNumTerminationReasons(void) const { return mNumTerminationReasons; }
+    const TerminationReason &GetTerminationReason(uint8_t aIndex) const { return mTerminationReasons[aIndex]; }
+    uint32_t         GetTerminationReasonsDropped(void) const { return mTerminationReasonsDropped; }
+
+    void Log(void) const;
+
+private:
+    static void Record(Histogram &aHistogram, uint32_t aBaseMS, uint32_t aValueMS);
+    static uint32_t ElapsedMS(uint64_t aStartMS);
+
+    void CountTermination(WEAVE_ERROR aReason, bool aIsStatusCodeValid, uint32_t aStatusProfileId,
+                          uint16_t aStatusCode);
+
+    Histogram mSubscribeLatency;
+    Histogram mCounterSubscribeLatency;
+    Histogram mNotifyRoundTripTime;
+
+    uint32_t mResubscribeAttempts;
+    uint32_t mResubscribeCauses[kResubscribeCause_Max];
+
+    TerminationReason mTerminationReasons[kMaxTerminationReasons];
+    uint8_t           mNumTerminationReasons;
+    uint32_t          mTerminationReasonsDropped;
+
+    // Start of the current (re)connection, for the latency histograms.
+    uint64_t mSubscribeStartMS;
+    uint64_t mCounterSubscribeStartMS;
+    bool     mIsAwaitingSubscription;
+    bool     mIsAwaitingCounterSubscription;
+    bool     mHaveServiceConnectivity;
+    bool     mIsResubscribePending;
+};
+
+#endif // SUBSCRIPTION_METRICS_H
@@ -0,0 +1,101 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/**
+ *    @file
+ *      Compile-time worst-case sizes of Weave TLV elements, used to size buffers
+ *      for trait, event and command encodings exactly.
+ *
+ *      Every function takes the size of the element's tag: kContextTag (the
+ *      default) for a context-tagged element, or kAnonymous.
+ *
+ */
+
+#ifndef TLV_SIZE_H
+#define TLV_SIZE_H
+
+#include <stddef.h>
+
+namespace TLVSize {
+
+enum
+{
+    kAnonymous  = 0,
+    kContextTag = 1,
+};
+
+// Control byte, tag and value.
+constexpr size_t Element(size_t aValueSize, size_t aTagSize = kContextTag)
+{
+    return 1 + aTagSize + aValueSize;
+}
+
+constexpr size_t Null(size_t aTagSize = kContextTag)
+{
+    return Element(0, aTagSize);
+}
+
+constexpr size_t Bool(size_t aTagSize = kContextTag)
+{
+    return Element(0, aTagSize);
+}
+
+// Signed or unsigned integers.  Values are encoded in the fewest bytes that hold
+// them; these are the maxima.
+constexpr size_t Int16(size_t aTagSize = kContextTag)
+{
+    return Element(2, aTagSize);
+}
+
+constexpr size_t Int32(size_t aTagSize = kContextTag)
+{
+    return Element(4, aTagSize);
+}
+
+constexpr size_t Int64(size_t aTagSize = kContextTag)
+{
+    return Element(8, aTagSize);
+}
+
+// UTF-8 and byte strings: a 1 byte length below 256 bytes, 2 bytes below 64K.
+constexpr size_t String(size_t aMaxLength, size_t aTagSize = kContextTag)
+{
+    return Element(((aMaxLength < 256) ? 1 : 2) + aMaxLength, aTagSize);
+}
+
+constexpr size_t ByteString(size_t aMaxLength, size_t aTagSize = kContextTag)
+{
+    return String(aMaxLength, aTagSize);
+}
+
+// A structure's members are followed by an end-of-container byte.
+constexpr size_t Structure(size_t aMembersSize, size_t aTagSize = kContextTag)
+{
+    return Element(aMembersSize, aTagSize) + 1;
+}
+
+// Arrays, like structures, end with an end-of-container byte.  Their members are
+// anonymous.
+constexpr size_t Array(size_t aMembersSize, size_t aTagSize = kContextTag)
+{
+    return Structure(aMembersSize, aTagSize);
+}
+
+} // namespace TLVSize
+
+#endif // TLV_SIZE_H
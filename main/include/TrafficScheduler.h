@@ -0,0 +1,149 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/**
+ *    @file
+ *      Orders the device's outbound Weave traffic by class, so that bulk transfers
+ *      give way to lock commands on the sleepy Thread link.
+ *
+ */
+
+#ifndef TRAFFIC_SCHEDULER_H
+#define TRAFFIC_SCHEDULER_H
+
+#include <stdint.h>
+
+#include <Weave/Core/WeaveCore.h>
+
+#include "AppConfig.h"
+
+/**
+ *  Outbound traffic falls into three classes, served in order:
+ *
+ *    - Interactive: lock command responses and lock-state notifies.
+ *    - Events: event offloads to the service.
+ *    - Bulk: software update image blocks.
+ *
+ *  Weave has no per-message transmit queue to reorder, so classes are scheduled
+ *  where their traffic originates.  A command, or an urgent notify, opens an
+ *  interactive window that lasts APP_TRAFFIC_INTERACTIVE_HOLD_MS from the last
+ *  such exchange.  While it is open:
+ *
+ *    - Only batched event offloads are deferred: an event buffer at its high-water
+ *      mark waits for the batched notify burst instead of forcing one.  The urgent
+ *      notify itself is built by the notification engine, which puts the trait data
+ *      first but also includes any pending events; there is no way to hold events
+ *      back from it.
+ *    - An image download in progress is preempted.  The software update manager
+ *      cannot pause a download, so it is aborted, and resumed with a new update
+ *      check when the window closes.  That repeats the image query, and the
+ *      download continues from the partial image offset.  Whether the offset was
+ *      used is logged and counted (resumed or restarted).
+ *
+ *  A download is preempted at most APP_TRAFFIC_MAX_BULK_PREEMPTIONS times, so that
+ *  a busy lock still gets its update.
+ *
+ *  Command latency, from the command being dispatched to its response being sent,
+ *  is recorded separately for commands that arrive during an image download.
+ *  Only accessed on the Weave task.
+ */
+class TrafficScheduler
+{
+public:
+    enum TrafficClass
+    {
+        kTrafficClass_Interactive = 0,
+        kTrafficClass_Events,
+        kTrafficClass_Bulk,
+
+        kTrafficClass_Max
+    };
+
+    enum
+    {
+        kNumHistogramBuckets = 8,
+
+        // Bucket 0 counts latencies below the base, bucket i latencies below (base << i),
+        // and the last bucket everything larger.
+        kCommandLatencyBaseMS = 25,
+    };
+
+    // Called with aMayProceed false to stop the class's traffic in progress, and true
+    // when traffic held back may resume.
+    typedef void (*SchedulingFunct)(TrafficClass aClass, bool aMayProceed);
+
+    struct CommandLatency
+    {
+        uint32_t Counts[kNumHistogramBuckets];
+        uint32_t Commands;
+        uint32_t MaxMS;
+        uint64_t TotalMS;
+    };
+
+    void Init(SchedulingFunct aSchedulingFunct);
+
+    // Opens, or extends, the interactive window.
+    void OnInteractiveExchange(void);
+
+    // Returns true if traffic of the class may be sent now.  Otherwise the deferral is
+    // counted, and the scheduling function is called when the class may resume.
+    bool MayProceed(TrafficClass aClass);
+
+    bool IsInteractiveWindowOpen(void) const { return mIsInteractiveWindowOpen; }
+
+    // Image download progress, as reported by the software update manager.  aPartialLen is
+    // the length of the partial image the download continues from.
+    void OnBulkTransferStarting(uint32_t aPartialLen);
+    void OnBulkTransferStarted(void);
+    void OnBulkTransferFinished(bool aCompleted);
+    bool IsBulkTransferActive(void) const { return mIsBulkTransferActive; }
+
+    // Called as the response to a command dispatched at aDispatchedMS is sent.
+    void OnCommandResponse(uint64_t aDispatchedMS);
+
+    const CommandLatency & GetCommandLatency(bool aDuringBulkTransfer) const
+    {
+        return mCommandLatency[aDuringBulkTransfer ? 1 : 0];
+    }
+
+    void Log(void) const;
+
+private:
+    static void HandleInteractiveHoldTimer(::nl::Weave::System::Layer * aLayer, void * aAppState,
+                                           ::nl::Weave::System::Error aError);
+    void CloseInteractiveWindow(void);
+
+    SchedulingFunct mSchedulingFunct;
+
+    // Indexed by whether an image download was in progress.
+    CommandLatency mCommandLatency[2];
+
+    uint32_t mDeferrals[kTrafficClass_Max];
+    uint32_t mInteractiveWindows;
+    uint32_t mBulkPreemptions;
+    uint32_t mBulkResumes;  // Preempted downloads continued from the partial image.
+    uint32_t mBulkRestarts; // Preempted downloads started again from the beginning.
+    uint8_t mTransferPreemptions; // Of the current image download.
+    bool mIsInteractiveWindowOpen;
+    bool mIsBulkTransferActive;
+    bool mIsBulkPreempted;
+    bool mIsBulkResumePending;
+    bool mIsDeferred[kTrafficClass_Max];
+};
+
+#endif // TRAFFIC_SCHEDULER_H
@@ -25,6 +25,16 @@
 #include "traits/include/BoltLockTraitDataSource.h"
 #include "traits/include/DeviceIdentityTraitDataSource.h"
 #include "traits/include/BoltLockSettingsTraitDataSink.h"
+#include "traits/include/SubscriptionDiagnosticsTraitDataSource.h"
+
+#include "AppConfig.h"
+#include "EventOffloadController.h"
+#include "ResubscribeBackoff.h"
+#include "ServiceSessionStore.h"
+#include "RttEstimator.h"
+#include "SubscriptionLivenessPolicy.h"
+#include "SubscriptionMetrics.h"
+#include "TrafficScheduler.h"
 
 #include "FreeRTOS.h"
 #include "semphr.h"
@@ -41,10 +51,40 @@ public:
     // Gives the mutex recursively.
     WEAVE_ERROR Unlock();
 
+    // Contention statistics, measured from the outermost Lock() to the matching Unlock().
+    struct Stats
+    {
+        uint32_t AcquireCount;
+        uint32_t ContendedCount;
+        uint32_t MaxWaitUS;
+        uint32_t MaxHoldUS;
+        uint64_t TotalHoldUS;
+    };
+
+    const Stats &GetStats(void) const { return mStats; }
+    void         LogStats(void) const;
+
 private:
     SemaphoreHandle_t mRecursiveLock;
+    uint64_t          mHoldStartUS;
+    uint32_t          mDepth;
+    Stats             mStats;
 };
 
+/**
+ *  The traits published and subscribed to by the device, one entry per trait instance:
+ *  (name, data source or sink type, member, instance id).  The catalog handles, the
+ *  data source and sink members, their catalog registration and the service
+ *  subscription path list are all generated from these lists.  A trait's handle is its
+ *  index in the catalog store, so lookups by handle are direct.
+ */
+#define WDM_SOURCE_TRAITS(SOURCE)                                                                                      \
+    SOURCE(BoltLockTrait, BoltLockTraitDataSource, mBoltLockTraitSource, 0)                                            \
+    SOURCE(DeviceIdentityTrait, DeviceIdentityTraitDataSource, mDeviceIdentityTraitSource, 0)                          \
+    SOURCE(SubscriptionDiagnosticsTrait, SubscriptionDiagnosticsTraitDataSource, mSubscriptionDiagnosticsTraitSource, 0)
+
+#define WDM_SINK_TRAITS(SINK) SINK(BoltLockSettingsTrait, BoltLockSettingsTraitDataSink, mBoltLockSettingsTraitSink, 0)
+
 class WDMFeature
 {
     typedef ::nl::Weave::Profiles::DataManagement_Current::SubscriptionClient  SubscriptionClient;
@@ -57,44 +97,125 @@ class WDMFeature
     typedef ::nl::Weave::Profiles::DataManagement_Current::PropertyPathHandle  PropertyPathHandle;
 
 public:
+    enum NotifyUrgency
+    {
+        kNotifyUrgency_Batched = 0, // Sent with the next notify burst.
+        kNotifyUrgency_Urgent,      // Sent now, with any batched changes.
+    };
+
     WDMFeature(void);
     WEAVE_ERROR Init(void);
-    void        ProcessTraitChanges(void);
+    void        ProcessTraitChanges(NotifyUrgency aUrgency = kNotifyUrgency_Urgent);
     void        TearDownSubscriptions(void);
 
+    // Re-establishes the service session and subscriptions ahead of need, if they are
+    // down.  May be called from any task.
+    void PrewarmServiceSession(void);
+
     bool AreServiceSubscriptionsEstablished(void);
 
     BoltLockTraitDataSource &GetBoltLockTraitDataSource(void);
+    TrafficScheduler &       GetTrafficScheduler(void);
+    ServiceSessionStore &    GetServiceSessionStore(void);
 
     nl::Weave::Profiles::DataManagement::SubscriptionEngine mSubscriptionEngine;
 
 private:
     friend WDMFeature &WdmFeature(void);
 
+#define WDM_SOURCE_HANDLE(NAME, TYPE, MEMBER, INSTANCE) kSourceHandle_##NAME,
+#define WDM_SINK_HANDLE(NAME, TYPE, MEMBER, INSTANCE) kSinkHandle_##NAME,
+
     enum SourceTraitHandle
     {
-        kSourceHandle_BoltLockTrait = 0,
-        kSourceHandle_DeviceIdentityTrait,
+        WDM_SOURCE_TRAITS(WDM_SOURCE_HANDLE)
 
         kSourceHandle_Max
     };
 
     enum SinkTraitHandle
     {
-        kSinkHandle_BoltLockSettingsTrait = 0,
+        WDM_SINK_TRAITS(WDM_SINK_HANDLE)
 
         kSinkHandle_Max
     };
 
+#undef WDM_SINK_HANDLE
+#undef WDM_SOURCE_HANDLE
+
+    enum
+    {
+        // The service counter-subscription and the local subscribers.
+        kMaxSubscribers = 1 + APP_MAX_LOCAL_SUBSCRIBERS,
+    };
+
+    // An admitted subscription from a local fabric device.
+    struct LocalSubscriber
+    {
+        SubscriptionHandler *Handler;
+        uint64_t             NodeId;
+        bool                 IsEstablished;
+    };
+
+    // Notification engine run time following a BoltLockTrait change, by the number of
+    // established subscriptions it fanned out to.
+    struct NotifyCost
+    {
+        uint32_t Runs;
+        uint64_t TotalUS;
+    };
+
+    SubscriptionLivenessPolicy mLivenessPolicy;
+
+    // Retry intervals of the service subscription.
+    ResubscribeBackoff mResubscribeBackoff;
+
+    // The shared CASE session with the service, kept across reboots.
+    ServiceSessionStore mServiceSession;
+
+    // Round-trip time to the service, from which WRM retransmission timeouts are derived.
+    RttEstimator mServiceRtt;
+
+    // When the event buffers are offloaded.
+    EventOffloadController mEventOffload;
+
+    // Order of the outbound traffic classes.
+    TrafficScheduler mTrafficScheduler;
+
+    // Subscription metrics, published by the SubscriptionDiagnosticsTrait.
+    SubscriptionMetrics mSubscriptionMetrics;
+
+#define WDM_TRAIT_MEMBER(NAME, TYPE, MEMBER, INSTANCE) TYPE MEMBER;
+
     // Published Traits
-    BoltLockTraitDataSource       mBoltLockTraitSource;
-    DeviceIdentityTraitDataSource mDeviceIdentityTraitSource;
+    WDM_SOURCE_TRAITS(WDM_TRAIT_MEMBER)
 
     // Subscribed Traits
-    BoltLockSettingsTraitDataSink mBoltLockSettingsTraitSink;
+    WDM_SINK_TRAITS(WDM_TRAIT_MEMBER)
+
+#undef WDM_TRAIT_MEMBER
 
     void        InitiateSubscriptionToService(void);
     static void AsyncProcessChanges(intptr_t arg);
+    static void HandleNotifyBatchTimer(::nl::Weave::System::Layer *aLayer, void *aAppState,
+                                       ::nl::Weave::System::Error aError);
+    void        RunNotificationEngine(void);
+    static void HandleNotifyAck(::nl::Weave::ExchangeContext *ec, void *msgCtxt);
+    static void HandleLivenessStableTimer(::nl::Weave::System::Layer *aLayer, void *aAppState,
+                                          ::nl::Weave::System::Error aError);
+    void        RenewSubscriptionToService(void);
+    static void AsyncPrewarmServiceSession(intptr_t arg);
+    static void HandleTrafficScheduling(TrafficScheduler::TrafficClass aClass, bool aMayProceed);
+
+    bool             AdmitLocalSubscriber(const SubscriptionHandler::InEventParam &inParam, uint16_t &aStatusCode);
+    LocalSubscriber *FindLocalSubscriber(const SubscriptionHandler *aHandler);
+    uint8_t          CountEstablishedSubscribers(void) const;
+    void             RecordNotifyCost(uint8_t aNumSubscribers, uint32_t aRunUS);
+
+    ::nl::Weave::WRMPConfig GetServiceWRMPConfig(void) const;
+    void                    ApplyServiceWRMPConfig(void);
+
+    uint32_t mLastLoggedMaxHoldUS;
 
     static void PlatformEventHandler(const ::nl::Weave::DeviceLayer::WeaveDeviceEvent *event, intptr_t arg);
     static void HandleSubscriptionEngineEvent(void *                                  appState,
@@ -105,6 +226,9 @@ private:
                                           ::nl::Weave::Binding::EventType           eventType,
                                           const ::nl::Weave::Binding::InEventParam &inParam,
                                           ::nl::Weave::Binding::OutEventParam &     outParam);
+    static void HandleResubscribePolicy(void *const                          aAppState,
+                                        SubscriptionClient::ResubscribeParam &aInParam,
+                                        uint32_t &                           aOutIntervalMsec);
     static void HandleOutboundServiceSubscriptionEvent(void *                                  appState,
                                                        SubscriptionClient::EventID             eventType,
                                                        const SubscriptionClient::InEventParam &inParam,
@@ -132,6 +256,9 @@ private:
     // Subscription Handler
     nl::Weave::Profiles::DataManagement::SubscriptionHandler *mServiceCounterSubHandler;
 
+    // Subscription Handlers for local fabric devices
+    LocalSubscriber mLocalSubscribers[APP_MAX_LOCAL_SUBSCRIBERS];
+
     // Binding
     nl::Weave::Binding *mServiceSubBinding;
 
@@ -141,6 +268,27 @@ private:
     bool mIsSubToServiceEstablished;
     bool mIsServiceCounterSubEstablished;
     bool mIsSubToServiceActivated;
+    bool mWasServiceSubActivatable; // Service connectivity and pairing, at the last platform event.
+    bool mIsRenewingServiceSub;     // Set while a renewal aborts the service subscription.
+
+    // Start times of the most recent pre-warms, oldest at mNextPrewarm.
+    uint64_t mPrewarmTimesMS[APP_SERVICE_PREWARM_MAX_PER_HOUR];
+    uint8_t  mNextPrewarm;
+    uint8_t  mNumPrewarms;
+    uint32_t mPrewarmsSkipped;
+
+    // Send time of the notify outstanding on the counter-subscription, for the round-trip metric.
+    uint64_t mNotifyStartMS;
+    uint32_t mNotifyRetransTimeoutMS;
+
+    NotifyCost mNotifyCost[kMaxSubscribers + 1];
+
+    // Notify batching: requests for the burst being gathered, and in total.
+    uint32_t mNotifyBatchWindowMS;
+    uint32_t mNotifyBatchRequests;
+    uint32_t mNotifyRequests;
+    uint32_t mNotifyBursts;
+    bool     mIsNotifyBatchPending;
 };
 
 inline WDMFeature &WdmFeature(void)
@@ -153,4 +301,14 @@ inline BoltLockTraitDataSource &WDMFeature::GetBoltLockTraitDataSource(void)
     return mBoltLockTraitSource;
 }
 
+inline TrafficScheduler &WDMFeature::GetTrafficScheduler(void)
+{
+    return mTrafficScheduler;
+}
+
+inline ServiceSessionStore &WDMFeature::GetServiceSessionStore(void)
+{
+    return mServiceSession;
+}
+
 #endif // WDM_FEATURE_H
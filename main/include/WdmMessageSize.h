@@ -0,0 +1,84 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/**
+ *    @file
+ *      Compile-time capacities of the messages and buffers that trait, event and
+ *      command encodings must fit in, for checking the worst-case sizes computed
+ *      with TLVSize.h.
+ *
+ */
+
+#ifndef WDM_MESSAGE_SIZE_H
+#define WDM_MESSAGE_SIZE_H
+
+#include <stddef.h>
+
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+
+#include "TLVSize.h"
+
+namespace WdmMessageSize {
+
+enum
+{
+    // Payload room in a single packet buffer, once the transport and Weave message
+    // headers have been reserved in front of it.
+    kMaxPayloadSize = WEAVE_SYSTEM_CONFIG_PACKETBUFFER_CAPACITY_MAX - WEAVE_SYSTEM_CONFIG_HEADER_RESERVE_SIZE,
+
+    // The path of a trait instance: a resource id, trait profile id and instance id.
+    kTraitPathSize = TLVSize::Structure(TLVSize::Structure(TLVSize::Int64() + TLVSize::Int32() + TLVSize::Int64())),
+
+    // The path and data version that wrap a trait instance's data in a notify.
+    kDataElementOverhead = TLVSize::Structure(kTraitPathSize + TLVSize::Int64(), TLVSize::kAnonymous),
+
+    // A notify request holding one data element and no events: the subscription id and
+    // the data list.
+    kNotifyRequestOverhead = TLVSize::Structure(TLVSize::Int64() + TLVSize::Array(kDataElementOverhead),
+                                                TLVSize::kAnonymous),
+
+    // The header fields of a logged event: source, importance, id, timestamps, trait
+    // path and event type.
+    kEventHeaderSize = TLVSize::Structure(3 * TLVSize::Int64() + TLVSize::Int16() + 2 * TLVSize::Int64() +
+                                          2 * TLVSize::Int32() + TLVSize::Int64(), TLVSize::kAnonymous),
+
+    // A custom command response: the trait data version around the response data.
+    kCommandResponseOverhead = TLVSize::Structure(TLVSize::Int64(), TLVSize::kAnonymous),
+};
+
+// True if a trait instance of this encoded size fits in a single notify.
+constexpr bool FitsInNotify(size_t aTraitSize)
+{
+    return aTraitSize + kNotifyRequestOverhead <= kMaxPayloadSize;
+}
+
+// True if an event with data of this encoded size fits in an event buffer of this size.
+constexpr bool FitsInEventBuffer(size_t aEventDataSize, size_t aBufferSize)
+{
+    return aEventDataSize + kEventHeaderSize <= aBufferSize;
+}
+
+// True if a command response with data of this encoded size fits in a single message.
+constexpr bool FitsInCommandResponse(size_t aResponseSize)
+{
+    return aResponseSize + kCommandResponseOverhead <= kMaxPayloadSize;
+}
+
+} // namespace WdmMessageSize
+
+#endif // WDM_MESSAGE_SIZE_H
@@ -111,11 +111,18 @@
  * WEAVE_CONFIG_MAX_BINDINGS
  *
  * Maximum number of simultaneously active bindings per WeaveExchangeManager
- * 1 (Time Sync) + 2 (Two 1-way subscriptions) + 1 (Software Update) = 4
- * in the worst case. Keeping another 4 as buffer.
+ * 1 (Time Sync) + 2 (Two 1-way subscriptions) + 1 (Software Update) +
+ * 2 (Local subscribers) = 6 in the worst case. Keeping another 2 as buffer.
  */
 #define WEAVE_CONFIG_MAX_BINDINGS 8
 
+/**
+ * WDM_PUBLISHER_MAX_NUM_SUBSCRIPTION_HANDLERS
+ *
+ * 1 (Service counter-subscription) + APP_MAX_LOCAL_SUBSCRIBERS (2) = 3.
+ */
+#define WDM_PUBLISHER_MAX_NUM_SUBSCRIPTION_HANDLERS 3
+
 /**
  * WEAVE_CONFIG_EVENT_LOGGING_WDM_OFFLOAD
  *
@@ -130,6 +137,15 @@
  */
 #define WEAVE_CONFIG_EVENT_LOGGING_UTC_TIMESTAMPS 1
 
+/**
+ * WEAVE_CONFIG_EVENT_LOGGING_BYTE_THRESHOLD
+ *
+ * Bytes logged after which the logger offloads events on its own.  Raised to the
+ * event buffer size, so that offloads are driven by the EventOffloadController's
+ * high-water marks and this is only a backstop.
+ */
+#define WEAVE_CONFIG_EVENT_LOGGING_BYTE_THRESHOLD (1024)
+
 /**
  * WEAVE_DEVICE_CONFIG_EVENT_LOGGING_DEBUG_BUFFER_SIZE
  *
@@ -17,6 +17,7 @@
  */
 
 #include <schema/include/BoltLockSettingsTrait.h>
+#include <schema/include/SchemaTable.h>
 
 namespace Schema {
 namespace Weave {
@@ -27,14 +28,19 @@ namespace BoltLockSettingsTrait {
 using namespace ::nl::Weave::Profiles::DataManagement;
 
 //
-// Property Table
+// Properties
 //
 
-const TraitSchemaEngine::PropertyInfo PropertyMap[] = {
-    { kPropertyHandle_Root, 1 }, // auto_relock_on
-    { kPropertyHandle_Root, 2 }, // auto_relock_duration
+constexpr SchemaTable::Property Properties[] = {
+    // Handle                             Parent                Tag  Flags
+    { kPropertyHandle_AutoRelockOn,       kPropertyHandle_Root, 1,   SchemaTable::kNone }, // auto_relock_on
+    { kPropertyHandle_AutoRelockDuration, kPropertyHandle_Root, 2,   SchemaTable::kNone }, // auto_relock_duration
 };
 
+typedef SchemaTable::Tables<Properties, SchemaTable::Count(Properties)> Tables;
+
+static_assert(Tables::kNumHandles == kLastSchemaHandle + 1, "BoltLockSettingsTrait properties do not match its handles");
+
 //
 // Schema
 //
@@ -42,17 +48,17 @@ const TraitSchemaEngine::PropertyInfo PropertyMap[] = {
 const TraitSchemaEngine TraitSchema = {
     {
         kWeaveProfileId,
-        PropertyMap,
-        sizeof(PropertyMap) / sizeof(PropertyMap[0]),
-        1,
+        Tables::PropertyMap,
+        Tables::kNumProperties,
+        Tables::kTreeDepth,
 #if (TDM_EXTENSION_SUPPORT) || (TDM_VERSIONING_SUPPORT)
         2,
 #endif
         NULL,
+        Tables::OptionalBitfield(),
         NULL,
-        NULL,
-        NULL,
-        NULL,
+        Tables::NullableBitfield(),
+        Tables::EphemeralBitfield(),
 #if (TDM_EXTENSION_SUPPORT)
         NULL,
 #endif
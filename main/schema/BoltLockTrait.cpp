@@ -17,6 +17,7 @@
  */
 
 #include <schema/include/BoltLockTrait.h>
+#include <schema/include/SchemaTable.h>
 
 namespace Schema {
 namespace Weave {
@@ -27,35 +28,27 @@ namespace BoltLockTrait {
 using namespace ::nl::Weave::Profiles::DataManagement;
 
 //
-// Property Table
+// Properties
 //
 
-const TraitSchemaEngine::PropertyInfo PropertyMap[] = {
-    { kPropertyHandle_Root, 1 }, // state
-    { kPropertyHandle_Root, 2 }, // actuator_state
-    { kPropertyHandle_Root, 3 }, // locked_state
-    { kPropertyHandle_Root, 4 }, // bolt_lock_actor
-    { kPropertyHandle_BoltLockActor, 1 }, // method
-    { kPropertyHandle_BoltLockActor, 2 }, // originator
-    { kPropertyHandle_BoltLockActor, 3 }, // agent
-    { kPropertyHandle_Root, 5 }, // locked_state_last_changed_at
+constexpr SchemaTable::Property Properties[] = {
+    // Handle                                   Parent                          Tag  Flags
+    { kPropertyHandle_State,                    kPropertyHandle_Root,           1,   SchemaTable::kNone },      // state
+    { kPropertyHandle_ActuatorState,            kPropertyHandle_Root,           2,   SchemaTable::kNone },      // actuator_state
+    { kPropertyHandle_LockedState,              kPropertyHandle_Root,           3,   SchemaTable::kNone },      // locked_state
+    { kPropertyHandle_BoltLockActor,            kPropertyHandle_Root,           4,   SchemaTable::kNullable |
+                                                                                     SchemaTable::kEphemeral }, // bolt_lock_actor
+    { kPropertyHandle_BoltLockActor_Method,     kPropertyHandle_BoltLockActor,  1,   SchemaTable::kNone },      // method
+    { kPropertyHandle_BoltLockActor_Originator, kPropertyHandle_BoltLockActor,  2,   SchemaTable::kNullable },  // originator
+    { kPropertyHandle_BoltLockActor_Agent,      kPropertyHandle_BoltLockActor,  3,   SchemaTable::kNullable },  // agent
+    // locked_state_last_changed_at
+    { kPropertyHandle_LockedStateLastChangedAt, kPropertyHandle_Root,           5,   SchemaTable::kNullable |
+                                                                                     SchemaTable::kEphemeral },
 };
 
-//
-// IsNullable Table
-//
-
-uint8_t IsNullableHandleBitfield[] = {
-        0xe8
-};
-
-//
-// IsEphemeral Table
-//
+typedef SchemaTable::Tables<Properties, SchemaTable::Count(Properties)> Tables;
 
-uint8_t IsEphemeralHandleBitfield[] = {
-        0x88
-};
+static_assert(Tables::kNumHandles == kLastSchemaHandle + 1, "BoltLockTrait properties do not match its handles");
 
 //
 // Supported version
@@ -69,17 +62,17 @@ const ConstSchemaVersionRange traitVersion = { .mMinVersion = 1, .mMaxVersion =
 const TraitSchemaEngine TraitSchema = {
     {
         kWeaveProfileId,
-        PropertyMap,
-        sizeof(PropertyMap) / sizeof(PropertyMap[0]),
-        2,
+        Tables::PropertyMap,
+        Tables::kNumProperties,
+        Tables::kTreeDepth,
 #if (TDM_EXTENSION_SUPPORT) || (TDM_VERSIONING_SUPPORT)
         2,
 #endif
         NULL,
+        Tables::OptionalBitfield(),
         NULL,
-        NULL,
-        &IsNullableHandleBitfield[0],
-        &IsEphemeralHandleBitfield[0],
+        Tables::NullableBitfield(),
+        Tables::EphemeralBitfield(),
 #if (TDM_EXTENSION_SUPPORT)
         NULL,
 #endif
@@ -17,6 +17,7 @@
  */
 
 #include <weave/trait/description/DeviceIdentityTrait.h>
+#include <schema/include/SchemaTable.h>
 
 namespace Schema {
 namespace Weave {
@@ -27,37 +28,29 @@ namespace DeviceIdentityTrait {
 using namespace ::nl::Weave::Profiles::DataManagement;
 
 //
-// Property Table
+// Properties
 //
 
-const TraitSchemaEngine::PropertyInfo PropertyMap[] = {
-    { kPropertyHandle_Root, 1 }, // vendor_id
-    { kPropertyHandle_Root, 2 }, // vendor_id_description
-    { kPropertyHandle_Root, 3 }, // vendor_product_id
-    { kPropertyHandle_Root, 4 }, // product_id_description
-    { kPropertyHandle_Root, 5 }, // product_revision
-    { kPropertyHandle_Root, 6 }, // serial_number
-    { kPropertyHandle_Root, 7 }, // software_version
-    { kPropertyHandle_Root, 8 }, // manufacturing_date
-    { kPropertyHandle_Root, 9 }, // device_id
-    { kPropertyHandle_Root, 10 }, // fabric_id
+constexpr SchemaTable::Property Properties[] = {
+    // Handle                               Parent                Tag  Flags
+    { kPropertyHandle_VendorId,             kPropertyHandle_Root, 1,   SchemaTable::kNone },     // vendor_id
+    { kPropertyHandle_VendorIdDescription,  kPropertyHandle_Root, 2,   SchemaTable::kOptional |
+                                                                       SchemaTable::kNullable }, // vendor_id_description
+    { kPropertyHandle_VendorProductId,      kPropertyHandle_Root, 3,   SchemaTable::kNone },     // vendor_product_id
+    { kPropertyHandle_ProductIdDescription, kPropertyHandle_Root, 4,   SchemaTable::kOptional |
+                                                                       SchemaTable::kNullable }, // product_id_description
+    { kPropertyHandle_ProductRevision,      kPropertyHandle_Root, 5,   SchemaTable::kNone },     // product_revision
+    { kPropertyHandle_SerialNumber,         kPropertyHandle_Root, 6,   SchemaTable::kNone },     // serial_number
+    { kPropertyHandle_SoftwareVersion,      kPropertyHandle_Root, 7,   SchemaTable::kNone },     // software_version
+    { kPropertyHandle_ManufacturingDate,    kPropertyHandle_Root, 8,   SchemaTable::kOptional |
+                                                                       SchemaTable::kNullable }, // manufacturing_date
+    { kPropertyHandle_DeviceId,             kPropertyHandle_Root, 9,   SchemaTable::kOptional }, // device_id
+    { kPropertyHandle_FabricId,             kPropertyHandle_Root, 10,  SchemaTable::kOptional }, // fabric_id
 };
 
-//
-// IsOptional Table
-//
+typedef SchemaTable::Tables<Properties, SchemaTable::Count(Properties)> Tables;
 
-uint8_t IsOptionalHandleBitfield[] = {
-        0x8a, 0x3
-};
-
-//
-// IsNullable Table
-//
-
-uint8_t IsNullableHandleBitfield[] = {
-        0x8a, 0x0
-};
+static_assert(Tables::kNumHandles == kLastSchemaHandle + 1, "DeviceIdentityTrait properties do not match its handles");
 
 //
 // Schema
@@ -66,17 +59,17 @@ uint8_t IsNullableHandleBitfield[] = {
 const TraitSchemaEngine TraitSchema = {
     {
         kWeaveProfileId,
-        PropertyMap,
-        sizeof(PropertyMap) / sizeof(PropertyMap[0]),
-        1,
+        Tables::PropertyMap,
+        Tables::kNumProperties,
+        Tables::kTreeDepth,
 #if (TDM_EXTENSION_SUPPORT) || (TDM_VERSIONING_SUPPORT)
         2,
 #endif
         NULL,
-        &IsOptionalHandleBitfield[0],
-        NULL,
-        &IsNullableHandleBitfield[0],
+        Tables::OptionalBitfield(),
         NULL,
+        Tables::NullableBitfield(),
+        Tables::EphemeralBitfield(),
 #if (TDM_EXTENSION_SUPPORT)
         NULL,
 #endif
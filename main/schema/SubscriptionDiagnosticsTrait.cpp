@@ -0,0 +1,85 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include <schema/include/SubscriptionDiagnosticsTrait.h>
+#include <schema/include/SchemaTable.h>
+
+namespace Schema {
+namespace Example {
+namespace Trait {
+namespace Diagnostics {
+namespace SubscriptionDiagnosticsTrait {
+
+using namespace ::nl::Weave::Profiles::DataManagement;
+
+//
+// Properties
+//
+
+constexpr SchemaTable::Property Properties[] = {
+    // Handle                                    Parent                Tag  Flags
+    { kPropertyHandle_SubscribeLatency,          kPropertyHandle_Root, 1,   SchemaTable::kNone }, // subscribe_latency
+    { kPropertyHandle_CounterSubscribeLatency,   kPropertyHandle_Root, 2,   SchemaTable::kNone }, // counter_subscribe_latency
+    { kPropertyHandle_NotifyRoundTripTime,       kPropertyHandle_Root, 3,   SchemaTable::kNone }, // notify_round_trip_time
+    { kPropertyHandle_ResubscribeAttempts,       kPropertyHandle_Root, 4,   SchemaTable::kNone }, // resubscribe_attempts
+    { kPropertyHandle_ResubscribeCauses,         kPropertyHandle_Root, 5,   SchemaTable::kNone }, // resubscribe_causes
+    { kPropertyHandle_TerminationReasons,        kPropertyHandle_Root, 6,   SchemaTable::kNone }, // termination_reasons
+    { kPropertyHandle_TerminationReasonsDropped, kPropertyHandle_Root, 7,   SchemaTable::kNone }, // termination_reasons_dropped
+    { kPropertyHandle_SmoothedRtt,               kPropertyHandle_Root, 8,   SchemaTable::kNone }, // smoothed_rtt
+    { kPropertyHandle_RttVariance,               kPropertyHandle_Root, 9,   SchemaTable::kNone }, // rtt_variance
+    { kPropertyHandle_RetransmitTimeout,         kPropertyHandle_Root, 10,  SchemaTable::kNone }, // retransmit_timeout
+    { kPropertyHandle_RttSamples,                kPropertyHandle_Root, 11,  SchemaTable::kNone }, // rtt_samples
+    { kPropertyHandle_RttSamplesDiscarded,       kPropertyHandle_Root, 12,  SchemaTable::kNone }, // rtt_samples_discarded
+};
+
+typedef SchemaTable::Tables<Properties, SchemaTable::Count(Properties)> Tables;
+
+static_assert(Tables::kNumHandles == kLastSchemaHandle + 1, "SubscriptionDiagnosticsTrait properties do not match its handles");
+
+//
+// Schema
+//
+
+const TraitSchemaEngine TraitSchema = {
+    {
+        kWeaveProfileId,
+        Tables::PropertyMap,
+        Tables::kNumProperties,
+        Tables::kTreeDepth,
+#if (TDM_EXTENSION_SUPPORT) || (TDM_VERSIONING_SUPPORT)
+        2,
+#endif
+        NULL,
+        Tables::OptionalBitfield(),
+        NULL,
+        Tables::NullableBitfield(),
+        Tables::EphemeralBitfield(),
+#if (TDM_EXTENSION_SUPPORT)
+        NULL,
+#endif
+#if (TDM_VERSIONING_SUPPORT)
+        NULL,
+#endif
+    }
+};
+
+} // namespace SubscriptionDiagnosticsTrait
+} // namespace Diagnostics
+} // namespace Trait
+} // namespace Example
+} // namespace Schema
@@ -0,0 +1,238 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/**
+ *    @file
+ *      Compile-time generation of the TraitSchemaEngine tables for a trait from a
+ *      single declarative list of its properties.
+ *
+ *      A trait describes each property once, in handle order:
+ *
+ *          constexpr SchemaTable::Property Properties[] = {
+ *              // Handle                  Parent                Tag  Flags
+ *              { kPropertyHandle_State,   kPropertyHandle_Root, 1,   SchemaTable::kNone },
+ *              ...
+ *          };
+ *
+ *          typedef SchemaTable::Tables<Properties, SchemaTable::Count(Properties)> Tables;
+ *
+ *      From that, Tables provides the property map, the optional, nullable and
+ *      ephemeral bitfields and the tree depth expected by TraitSchemaEngine, plus
+ *      direct-indexed handle-to-tag and (parent, tag)-to-handle lookups.  The
+ *      description is checked at compile time: handles must be consecutive and
+ *      match the handle enum, parents must precede their children, and no two
+ *      children of a parent may share a tag.
+ *
+ *      Everything is constant-initialized, so the tables live in flash.
+ *
+ */
+
+#ifndef SCHEMA_TABLE_H
+#define SCHEMA_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <Weave/Profiles/data-management/DataManagement.h>
+
+namespace SchemaTable {
+
+typedef ::nl::Weave::Profiles::DataManagement::PropertyPathHandle PropertyPathHandle;
+typedef ::nl::Weave::Profiles::DataManagement::TraitSchemaEngine::PropertyInfo PropertyInfo;
+
+enum
+{
+    kRootHandle  = 1,
+    kFirstHandle = 2, // Handle of the first property; bit 0 of each bitfield.
+};
+
+enum PropertyFlags
+{
+    kNone      = 0x00,
+    kOptional  = 0x01,
+    kNullable  = 0x02,
+    kEphemeral = 0x04,
+};
+
+struct Property
+{
+    PropertyPathHandle Handle;
+    PropertyPathHandle Parent;
+    uint8_t ContextTag;
+    uint8_t Flags;
+};
+
+template <size_t N>
+constexpr size_t Count(const Property (&)[N])
+{
+    return N;
+}
+
+// ---- Compile-time helpers (C++11 constexpr, hence recursive) ----
+
+constexpr PropertyPathHandle FindChild(const Property * aProps, size_t aCount, PropertyPathHandle aParent, uint32_t aTag,
+                                       size_t aIndex = 0)
+{
+    return (aIndex == aCount)
+        ? static_cast<PropertyPathHandle>(::nl::Weave::Profiles::DataManagement::kNullPropertyPathHandle)
+        : (aProps[aIndex].Parent == aParent && aProps[aIndex].ContextTag == aTag)
+            ? aProps[aIndex].Handle
+            : FindChild(aProps, aCount, aParent, aTag, aIndex + 1);
+}
+
+constexpr bool IsWellFormed(const Property * aProps, size_t aCount, size_t aIndex = 0)
+{
+    return (aIndex == aCount) ||
+        (aProps[aIndex].Handle == aIndex + kFirstHandle && aProps[aIndex].Parent >= kRootHandle &&
+         aProps[aIndex].Parent < aProps[aIndex].Handle &&
+         FindChild(aProps, aCount, aProps[aIndex].Parent, aProps[aIndex].ContextTag) == aProps[aIndex].Handle &&
+         IsWellFormed(aProps, aCount, aIndex + 1));
+}
+
+constexpr uint8_t MaxTag(const Property * aProps, size_t aCount, size_t aIndex = 0)
+{
+    return (aIndex == aCount) ? 0
+        : (aProps[aIndex].ContextTag > MaxTag(aProps, aCount, aIndex + 1)) ? aProps[aIndex].ContextTag
+                                                                            : MaxTag(aProps, aCount, aIndex + 1);
+}
+
+constexpr uint32_t Depth(const Property * aProps, PropertyPathHandle aHandle)
+{
+    return (aHandle == kRootHandle) ? 0 : 1 + Depth(aProps, aProps[aHandle - kFirstHandle].Parent);
+}
+
+constexpr uint32_t TreeDepth(const Property * aProps, size_t aCount, size_t aIndex = 0)
+{
+    return (aIndex == aCount) ? 0
+        : (Depth(aProps, aProps[aIndex].Handle) > TreeDepth(aProps, aCount, aIndex + 1)) ? Depth(aProps, aProps[aIndex].Handle)
+                                                                                         : TreeDepth(aProps, aCount, aIndex + 1);
+}
+
+constexpr bool HasFlag(const Property * aProps, size_t aCount, uint8_t aFlag, size_t aIndex = 0)
+{
+    return (aIndex != aCount) && ((aProps[aIndex].Flags & aFlag) != 0 || HasFlag(aProps, aCount, aFlag, aIndex + 1));
+}
+
+constexpr uint8_t BitfieldByte(const Property * aProps, size_t aCount, uint8_t aFlag, size_t aByte, size_t aBit = 0)
+{
+    return (aBit == 8) ? 0
+                       : static_cast<uint8_t>(
+                             ((aByte * 8 + aBit < aCount && (aProps[aByte * 8 + aBit].Flags & aFlag) != 0) ? (1U << aBit) : 0) |
+                             BitfieldByte(aProps, aCount, aFlag, aByte, aBit + 1));
+}
+
+template <size_t... I>
+struct IndexSequence
+{
+};
+
+template <size_t N, size_t... I>
+struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, I...>
+{
+};
+
+template <size_t... I>
+struct MakeIndexSequence<0, I...>
+{
+    typedef IndexSequence<I...> Type;
+};
+
+// ---- Generated tables ----
+
+template <const Property * Props, size_t Count, typename PropertySeq = typename MakeIndexSequence<Count>::Type,
+          typename ByteSeq   = typename MakeIndexSequence<(Count + 7) / 8>::Type,
+          typename LookupSeq = typename MakeIndexSequence<(Count + kFirstHandle) * (MaxTag(Props, Count) + 1)>::Type>
+struct Tables;
+
+template <const Property * Props, size_t Count, size_t... P, size_t... B, size_t... L>
+struct Tables<Props, Count, IndexSequence<P...>, IndexSequence<B...>, IndexSequence<L...> >
+{
+    static_assert(IsWellFormed(Props, Count), "Trait properties must be listed in handle order, after their parent, "
+                                              "with tags unique within each parent");
+    static_assert(Count + kFirstHandle <= UINT8_MAX, "Too many properties for the handle lookup table");
+
+    enum : uint32_t
+    {
+        kNumProperties = Count,
+        kNumHandles    = Count + kFirstHandle,
+        kMaxTag        = MaxTag(Props, Count),
+        kTreeDepth     = TreeDepth(Props, Count),
+    };
+
+    static constexpr PropertyInfo PropertyMap[Count] = { { Props[P].Parent, Props[P].ContextTag }... };
+
+    static constexpr uint8_t IsOptionalHandleBitfield[sizeof...(B)]  = { BitfieldByte(Props, Count, kOptional, B)... };
+    static constexpr uint8_t IsNullableHandleBitfield[sizeof...(B)]  = { BitfieldByte(Props, Count, kNullable, B)... };
+    static constexpr uint8_t IsEphemeralHandleBitfield[sizeof...(B)] = { BitfieldByte(Props, Count, kEphemeral, B)... };
+
+    // Indexed by (parent handle * (kMaxTag + 1) + context tag).
+    static constexpr uint8_t ChildHandleTable[sizeof...(L)] = { static_cast<uint8_t>(
+        FindChild(Props, Count, static_cast<PropertyPathHandle>(L / (kMaxTag + 1)), L % (kMaxTag + 1)))... };
+
+    static constexpr uint8_t TagForHandle(PropertyPathHandle aHandle)
+    {
+        return (aHandle >= kFirstHandle && aHandle < kNumHandles) ? PropertyMap[aHandle - kFirstHandle].mContextTag : 0;
+    }
+
+    static constexpr PropertyPathHandle HandleForTag(PropertyPathHandle aParent, uint32_t aTag)
+    {
+        return (aParent < kNumHandles && aTag <= kMaxTag)
+            ? ChildHandleTable[aParent * (kMaxTag + 1) + aTag]
+            : static_cast<PropertyPathHandle>(::nl::Weave::Profiles::DataManagement::kNullPropertyPathHandle);
+    }
+
+    // TraitSchemaEngine takes non-const bitfield pointers, but only reads through them.  A trait
+    // with no property carrying a flag gets a NULL bitfield, as the schema compiler emits.
+    static constexpr uint8_t * OptionalBitfield(void)
+    {
+        return HasFlag(Props, Count, kOptional) ? const_cast<uint8_t *>(IsOptionalHandleBitfield) : NULL;
+    }
+
+    static constexpr uint8_t * NullableBitfield(void)
+    {
+        return HasFlag(Props, Count, kNullable) ? const_cast<uint8_t *>(IsNullableHandleBitfield) : NULL;
+    }
+
+    static constexpr uint8_t * EphemeralBitfield(void)
+    {
+        return HasFlag(Props, Count, kEphemeral) ? const_cast<uint8_t *>(IsEphemeralHandleBitfield) : NULL;
+    }
+};
+
+template <const Property * Props, size_t Count, size_t... P, size_t... B, size_t... L>
+constexpr PropertyInfo Tables<Props, Count, IndexSequence<P...>, IndexSequence<B...>, IndexSequence<L...> >::PropertyMap[Count];
+
+template <const Property * Props, size_t Count, size_t... P, size_t... B, size_t... L>
+constexpr uint8_t
+    Tables<Props, Count, IndexSequence<P...>, IndexSequence<B...>, IndexSequence<L...> >::IsOptionalHandleBitfield[sizeof...(B)];
+
+template <const Property * Props, size_t Count, size_t... P, size_t... B, size_t... L>
+constexpr uint8_t
+    Tables<Props, Count, IndexSequence<P...>, IndexSequence<B...>, IndexSequence<L...> >::IsNullableHandleBitfield[sizeof...(B)];
+
+template <const Property * Props, size_t Count, size_t... P, size_t... B, size_t... L>
+constexpr uint8_t
+    Tables<Props, Count, IndexSequence<P...>, IndexSequence<B...>, IndexSequence<L...> >::IsEphemeralHandleBitfield[sizeof...(B)];
+
+template <const Property * Props, size_t Count, size_t... P, size_t... B, size_t... L>
+constexpr uint8_t
+    Tables<Props, Count, IndexSequence<P...>, IndexSequence<B...>, IndexSequence<L...> >::ChildHandleTable[sizeof...(L)];
+
+} // namespace SchemaTable
+
+#endif // SCHEMA_TABLE_H
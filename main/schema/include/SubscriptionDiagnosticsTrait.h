@@ -0,0 +1,145 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#ifndef _WEAVE_TRAIT_DIAGNOSTICS__SUBSCRIPTION_DIAGNOSTICS_TRAIT_H_
+#define _WEAVE_TRAIT_DIAGNOSTICS__SUBSCRIPTION_DIAGNOSTICS_TRAIT_H_
+
+#include <Weave/Profiles/data-management/DataManagement.h>
+#include <Weave/Support/SerializationUtils.h>
+
+/*
+ *  A vendor-specific diagnostics trait publishing the device's service
+ *  subscription metrics (see SubscriptionMetrics.h).
+ *
+ *  The latency histograms are arrays of 8 counts.  Bucket 0 counts values
+ *  below the base, bucket i values below (base << i), and bucket 7 everything
+ *  larger.  The base is 500 ms for subscribe latencies and 100 ms for notify
+ *  round-trip times.
+ *
+ *  The RTT properties are the estimates from which the WRM retransmission
+ *  timeout to the service is derived (see RttEstimator.h).
+ */
+
+namespace Schema {
+namespace Example {
+namespace Trait {
+namespace Diagnostics {
+namespace SubscriptionDiagnosticsTrait {
+
+extern const nl::Weave::Profiles::DataManagement::TraitSchemaEngine TraitSchema;
+
+enum {
+      kWeaveProfileId = (0x235AU << 16) | 0xfe01U
+};
+
+//
+// Properties
+//
+
+enum {
+    kPropertyHandle_Root = 1,
+
+    //---------------------------------------------------------------------------------------------------------------------------//
+    //  Name                                IDL Type                            TLV Type           Optional?       Nullable?     //
+    //---------------------------------------------------------------------------------------------------------------------------//
+
+    //
+    //  subscribe_latency                   repeated uint32                      array             NO              NO
+    //
+    kPropertyHandle_SubscribeLatency = 2,
+
+    //
+    //  counter_subscribe_latency           repeated uint32                      array             NO              NO
+    //
+    kPropertyHandle_CounterSubscribeLatency = 3,
+
+    //
+    //  notify_round_trip_time              repeated uint32                      array             NO              NO
+    //
+    kPropertyHandle_NotifyRoundTripTime = 4,
+
+    //
+    //  resubscribe_attempts                uint32                               uint32            NO              NO
+    //
+    kPropertyHandle_ResubscribeAttempts = 5,
+
+    //
+    //  resubscribe_causes                  repeated uint32                      array             NO              NO
+    //
+    kPropertyHandle_ResubscribeCauses = 6,
+
+    //
+    //  termination_reasons                 repeated TerminationReason           array             NO              NO
+    //
+    kPropertyHandle_TerminationReasons = 7,
+
+    //
+    //  termination_reasons_dropped         uint32                               uint32            NO              NO
+    //
+    kPropertyHandle_TerminationReasonsDropped = 8,
+
+    //
+    //  smoothed_rtt                        google.protobuf.Duration             uint32 millisec   NO              NO
+    //
+    kPropertyHandle_SmoothedRtt = 9,
+
+    //
+    //  rtt_variance                        google.protobuf.Duration             uint32 millisec   NO              NO
+    //
+    kPropertyHandle_RttVariance = 10,
+
+    //
+    //  retransmit_timeout                  google.protobuf.Duration             uint32 millisec   NO              NO
+    //
+    kPropertyHandle_RetransmitTimeout = 11,
+
+    //
+    //  rtt_samples                         uint32                               uint32            NO              NO
+    //
+    kPropertyHandle_RttSamples = 12,
+
+    //
+    //  rtt_samples_discarded               uint32                               uint32            NO              NO
+    //
+    kPropertyHandle_RttSamplesDiscarded = 13,
+
+    //
+    // Enum for last handle
+    //
+    kLastSchemaHandle = 13,
+};
+
+//
+// Structs
+//
+
+// Fields of a TerminationReason.  The profile id is 0xFFFFFFFF, and the status code
+// a WEAVE_ERROR, for terminations not caused by a status report.
+enum TerminationReasonFields
+{
+    kTerminationReason_ProfileId  = 1,
+    kTerminationReason_StatusCode = 2,
+    kTerminationReason_Count      = 3,
+};
+
+} // namespace SubscriptionDiagnosticsTrait
+} // namespace Diagnostics
+} // namespace Trait
+} // namespace Example
+} // namespace Schema
+#endif // _WEAVE_TRAIT_DIAGNOSTICS__SUBSCRIPTION_DIAGNOSTICS_TRAIT_H_
@@ -28,8 +28,11 @@
 
 #include "BoltLockManager.h"
 #include "WDMFeature.h"
+#include "AppNvmStore.h"
 #include "AppConfig.h"
 
+#include <string.h>
+
 using namespace nl::Weave::TLV;
 using namespace nl::Weave::Profiles::DataManagement;
 
@@ -39,6 +42,125 @@ using namespace Schema::Weave::Trait::Security::BoltLockSettingsTrait;
 BoltLockSettingsTraitDataSink::BoltLockSettingsTraitDataSink()
     : TraitDataSink(&BoltLockSettingsTrait::TraitSchema)
 {
+    mAutoRelockOn             = false;
+    mAutoRelockDuration       = 0;
+    mStagedAutoRelockOn       = false;
+    mStagedAutoRelockDuration = 0;
+    mHasStagedChanges         = false;
+    mIsPersistedVersionValid  = false;
+    mPersistedVersion        = 0;
+}
+
+WEAVE_ERROR BoltLockSettingsTraitDataSink::Init(void)
+{
+    WEAVE_ERROR err;
+    PersistedSettings settings;
+
+    err = AppNvmStore::Read(AppNvmStore::kKey_BoltLockSettings, &settings, sizeof(settings));
+    if (err == WEAVE_DEVICE_ERROR_CONFIG_NOT_FOUND)
+    {
+        return WEAVE_NO_ERROR;
+    }
+    SuccessOrExit(err);
+
+    mAutoRelockOn             = (settings.AutoRelockOn != 0);
+    mAutoRelockDuration       = settings.AutoRelockDuration;
+    mStagedAutoRelockOn       = mAutoRelockOn;
+    mStagedAutoRelockDuration = mAutoRelockDuration;
+    mIsPersistedVersionValid  = true;
+    mPersistedVersion         = settings.DataVersion;
+
+    // Called on the app task during start-up.
+    BoltLockMgr().SetAutoRelockConfig(mAutoRelockOn, mAutoRelockDuration);
+
+    // With a valid version, the subscribe request carries it in its version list, and the
+    // service only sends the trait again if it has changed since.
+    SetVersion(settings.DataVersion);
+
+    EFR32_LOG("Restored BoltLockSettings (version 0x%" PRIx64 "): Auto Relock %s, %" PRIu32 " secs",
+              settings.DataVersion, (mAutoRelockOn) ? "ENABLED" : "DISABLED", mAutoRelockDuration);
+
+exit:
+    if (err != WEAVE_NO_ERROR)
+    {
+        EFR32_LOG("Failed to restore BoltLockSettings: %s", nl::ErrorStr(err));
+    }
+    return err;
+}
+
+WEAVE_ERROR BoltLockSettingsTraitDataSink::OnEvent(uint16_t aType, void * aInEventParam)
+{
+    switch (aType)
+    {
+        case kEventNotifyRequestBegin:
+            // A notify may carry only one of the settings; the other keeps its current value.
+            mStagedAutoRelockOn       = mAutoRelockOn;
+            mStagedAutoRelockDuration = mAutoRelockDuration;
+            mHasStagedChanges         = false;
+            break;
+
+        case kEventNotifyRequestEnd:
+            // The data version has been updated by the time the notify has been processed.
+            CommitStagedSettings();
+            PersistSettings();
+            break;
+
+        default:
+            break;
+    }
+
+    return WEAVE_NO_ERROR;
+}
+
+void BoltLockSettingsTraitDataSink::CommitStagedSettings(void)
+{
+    if (!mHasStagedChanges)
+    {
+        return;
+    }
+
+    mHasStagedChanges = false;
+
+    if (mStagedAutoRelockOn == mAutoRelockOn && mStagedAutoRelockDuration == mAutoRelockDuration)
+    {
+        return;
+    }
+
+    mAutoRelockOn       = mStagedAutoRelockOn;
+    mAutoRelockDuration = mStagedAutoRelockDuration;
+
+    // The lock manager and its timers belong to the app task, which applies both settings at once.
+    BoltLockMgr().PostAutoRelockConfig(mAutoRelockOn, mAutoRelockDuration);
+
+    EFR32_LOG("Auto Relock %s, Duration (secs): %" PRIu32, (mAutoRelockOn) ? "ENABLED" : "DISABLED",
+              mAutoRelockDuration);
+}
+
+void BoltLockSettingsTraitDataSink::PersistSettings(void)
+{
+    WEAVE_ERROR err;
+    PersistedSettings settings;
+
+    // Only write when the version moves, to keep NVM3 wear down.
+    if (!IsVersionValid() || (mIsPersistedVersionValid && mPersistedVersion == GetVersion()))
+    {
+        return;
+    }
+
+    memset(&settings, 0, sizeof(settings));
+    settings.DataVersion        = GetVersion();
+    settings.AutoRelockDuration = mAutoRelockDuration;
+    settings.AutoRelockOn       = mAutoRelockOn ? 1 : 0;
+
+    err = AppNvmStore::Write(AppNvmStore::kKey_BoltLockSettings, &settings, sizeof(settings));
+    if (err != WEAVE_NO_ERROR)
+    {
+        EFR32_LOG("Failed to persist BoltLockSettings: %s", nl::ErrorStr(err));
+        return;
+    }
+
+    mIsPersistedVersionValid = true;
+    mPersistedVersion        = settings.DataVersion;
 }
 
 WEAVE_ERROR
@@ -54,9 +176,8 @@ BoltLockSettingsTraitDataSink::SetLeafData(PropertyPathHandle aLeafHandle, TLVRe
             err = aReader.Get(auto_relock_on);
             nlREQUIRE_SUCCESS(err, exit);
 
-            BoltLockMgr().EnableAutoRelock(auto_relock_on);
-
-           EFR32_LOG("Auto Relock %s", (auto_relock_on) ? "ENABLED" : "DISABLED");
+            mStagedAutoRelockOn = auto_relock_on;
+            mHasStagedChanges   = true;
             break;
         }
 
@@ -66,9 +187,8 @@ BoltLockSettingsTraitDataSink::SetLeafData(PropertyPathHandle aLeafHandle, TLVRe
             err = aReader.Get(auto_lock_duration);
             nlREQUIRE_SUCCESS(err, exit);
 
-            BoltLockMgr().SetAutoLockDuration(auto_lock_duration);
-
-           EFR32_LOG("Auto Relock Duration (secs): %u", auto_lock_duration);
+            mStagedAutoRelockDuration = auto_lock_duration;
+            mHasStagedChanges         = true;
             break;
         }
 
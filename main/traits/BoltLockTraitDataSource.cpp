@@ -24,14 +24,17 @@
 
 
 #include <traits/include/BoltLockTraitDataSource.h>
+#include <traits/include/TraitLeafTable.h>
 #include <schema/include/BoltLockTrait.h>
 #include <WDMFeature.h>
 #include <BoltLockManager.h>
 #include <AppTask.h>
+#include <CommandExpiryChecker.h>
 #include <Weave/DeviceLayer/WeaveDeviceLayer.h>
 #include <Weave/Support/TraitEventUtils.h>
 
 #include "AppConfig.h"
+#include "WdmMessageSize.h"
 
 using namespace nl::Weave;
 using namespace nl::Weave::TLV;
@@ -39,158 +42,479 @@ using namespace nl::Weave::Profiles::DataManagement;
 using namespace Schema::Weave::Trait::Security;
 using namespace Schema::Weave::Trait::Security::BoltLockTrait;
 
-BoltLockTraitDataSource::BoltLockTraitDataSource() : TraitDataSource(&BoltLockTrait::TraitSchema)
+static_assert(BoltLockTrait::kLastSchemaHandle < 32, "BoltLockTrait handles must fit in the pending dirty mask");
+
+typedef BoltLockTraitDataSource::BoltLockState BoltLockState;
+
+// Leaves held directly in the trait state.  The rest are encoded in EncodeLeaf().
+static constexpr TraitLeafTable<BoltLockState>::Leaf sBoltLockLeaves[] = {
+    TRAIT_LEAF_NONE(0),
+    TRAIT_LEAF_NONE(BoltLockTrait::kPropertyHandle_Root),
+    TRAIT_LEAF(BoltLockTrait::kPropertyHandle_State, BoltLockState, State),
+    TRAIT_LEAF(BoltLockTrait::kPropertyHandle_ActuatorState, BoltLockState, ActuatorState),
+    TRAIT_LEAF(BoltLockTrait::kPropertyHandle_LockedState, BoltLockState, LockedState),
+    TRAIT_LEAF_NONE(BoltLockTrait::kPropertyHandle_BoltLockActor),
+    TRAIT_LEAF(BoltLockTrait::kPropertyHandle_BoltLockActor_Method, BoltLockState, LockActor),
+    TRAIT_LEAF_CUSTOM(BoltLockTrait::kPropertyHandle_BoltLockActor_Originator),
+    TRAIT_LEAF_CUSTOM(BoltLockTrait::kPropertyHandle_BoltLockActor_Agent),
+    TRAIT_LEAF_CUSTOM(BoltLockTrait::kPropertyHandle_LockedStateLastChangedAt),
+};
+
+static constexpr TraitLeafTable<BoltLockState> sBoltLockLeafTable(sBoltLockLeaves);
+
+static_assert(sBoltLockLeafTable.IsIndexedByHandle(), "BoltLockTrait leaves must be listed in handle order");
+static_assert(sizeof(sBoltLockLeaves) / sizeof(sBoltLockLeaves[0]) == BoltLockTrait::kLastSchemaHandle + 1,
+              "Every BoltLockTrait handle must have a leaf entry");
+
+static_assert(WdmMessageSize::FitsInNotify(BoltLockTraitDataSource::kMaxEncodedSize),
+              "BoltLockTrait can exceed a single notify");
+// The event is logged at ProductionCritical importance.
+static_assert(WdmMessageSize::FitsInEventBuffer(BoltLockTraitDataSource::kMaxStateChangeEventSize,
+                                                WEAVE_DEVICE_CONFIG_EVENT_LOGGING_CRIT_BUFFER_SIZE),
+              "BoltActuatorStateChangeEvent can exceed the critical event buffer");
+#if APP_DEFERRED_COMMAND_RESPONSE
+static_assert(WdmMessageSize::FitsInCommandResponse(BoltLockTraitDataSource::kMaxBoltLockChangeResponseSize),
+              "BoltLockChangeResponse can exceed a single message");
+#endif
+
+#if APP_COMPACT_BOLT_LOCK_EVENTS
+
+// Compact BoltActuatorStateChangeEvent encoding.
+//
+// The schema encoding of the event data takes 22 bytes: three enums written as separate
+// context-tagged integers, plus a BoltLockActorStruct that carries explicit nulls for the
+// originator and agent fields.  The compact encoding packs the four enums into a single
+// 16-bit value and omits null fields, taking 7 bytes (plus the originator and agent ids,
+// when present).
+//
+// Compact events are logged with a system timestamp, which the event logger delta-encodes
+// against the previous event in the same buffer (typically 4-6 bytes), rather than the
+// absolute 64-bit UTC timestamp (10 bytes) used when WEAVE_CONFIG_EVENT_LOGGING_UTC_TIMESTAMPS
+// is enabled.  Overall a lock cycle (4 events) shrinks by roughly 80 bytes.
+//
+// The compact form is a distinct event structure type, so the consumer must understand it.
+enum
 {
-    mLockedState   = BOLT_LOCKED_STATE_LOCKED;
-    mLockActor     = BOLT_LOCK_ACTOR_METHOD_PHYSICAL;
-    mActuatorState = BOLT_ACTUATOR_STATE_OK;
-    mState         = BOLT_STATE_EXTENDED;
+    kCompactStateChangeEventTypeId = 0x81,
+
+    kCompactEventTag_PackedState = 1,
+    kCompactEventTag_Originator  = 2,
+    kCompactEventTag_Agent       = 3,
+
+    kPackedState_StateShift         = 0, // BoltState, 2 bits
+    kPackedState_ActuatorStateShift = 2, // BoltActuatorState, 3 bits
+    kPackedState_LockedStateShift   = 5, // BoltLockedState, 2 bits
+    kPackedState_MethodShift        = 7, // BoltLockActorMethod, 4 bits
+
+    kPackedState_StateMask         = 0x3,
+    kPackedState_ActuatorStateMask = 0x7,
+    kPackedState_LockedStateMask   = 0x3,
+    kPackedState_MethodMask        = 0xF,
+};
+
+static_assert(BOLT_STATE_EXTENDED <= kPackedState_StateMask &&
+                  BOLT_ACTUATOR_STATE_JAMMED_OTHER <= kPackedState_ActuatorStateMask &&
+                  BOLT_LOCKED_STATE_UNKNOWN <= kPackedState_LockedStateMask &&
+                  BOLT_LOCK_ACTOR_METHOD_VOICE_ASSISTANT <= kPackedState_MethodMask,
+              "BoltLockTrait enums must fit their packed fields");
+
+// Each field is masked to its width, so that a bad value cannot spill into its neighbours.
+static uint16_t PackField(int32_t aValue, uint16_t aMask, uint8_t aShift)
+{
+    return static_cast<uint16_t>((static_cast<uint32_t>(aValue) & aMask) << aShift);
 }
 
-bool BoltLockTraitDataSource::IsLocked()
+static const nl::Weave::Profiles::DataManagement::EventSchema sCompactStateChangeEventSchema =
 {
-    bool lock_state = false;
-    if (mLockedState == BOLT_LOCKED_STATE_LOCKED)
+    .mProfileId = BoltLockTrait::kWeaveProfileId,
+    .mStructureType = kCompactStateChangeEventTypeId,
+    .mImportance = nl::Weave::Profiles::DataManagement::ProductionCritical,
+    .mDataSchemaVersion = 1,
+    .mMinCompatibleDataSchemaVersion = 1,
+};
+
+static WEAVE_ERROR WriteCompactStateChangeEvent(TLVWriter & aWriter, uint8_t aDataTag, void * aAppData)
+{
+    const BoltActuatorStateChangeEvent * ev = static_cast<const BoltActuatorStateChangeEvent *>(aAppData);
+    WEAVE_ERROR err                         = WEAVE_NO_ERROR;
+    TLVType outerContainerType;
+    uint16_t packedState;
+
+    packedState = PackField(ev->state, kPackedState_StateMask, kPackedState_StateShift) |
+        PackField(ev->actuatorState, kPackedState_ActuatorStateMask, kPackedState_ActuatorStateShift) |
+        PackField(ev->lockedState, kPackedState_LockedStateMask, kPackedState_LockedStateShift) |
+        PackField(ev->boltLockActor.method, kPackedState_MethodMask, kPackedState_MethodShift);
+
+    err = aWriter.StartContainer(ContextTag(aDataTag), kTLVType_Structure, outerContainerType);
+    SuccessOrExit(err);
+
+    err = aWriter.Put(ContextTag(kCompactEventTag_PackedState), packedState);
+    SuccessOrExit(err);
+
+    if (!GET_FIELD_NULLIFIED_BIT(ev->boltLockActor.__nullified_fields__, 0))
     {
-        lock_state = true;
+        err = aWriter.PutBytes(ContextTag(kCompactEventTag_Originator), ev->boltLockActor.originator.mBuf,
+                               ev->boltLockActor.originator.mLen);
+        SuccessOrExit(err);
     }
 
-    return lock_state;
+    if (!GET_FIELD_NULLIFIED_BIT(ev->boltLockActor.__nullified_fields__, 1))
+    {
+        err = aWriter.PutBytes(ContextTag(kCompactEventTag_Agent), ev->boltLockActor.agent.mBuf,
+                               ev->boltLockActor.agent.mLen);
+        SuccessOrExit(err);
+    }
+
+    err = aWriter.EndContainer(outerContainerType);
+    SuccessOrExit(err);
+
+exit:
+    return err;
 }
 
-void BoltLockTraitDataSource::InitiateLock(int32_t aLockActor)
+#endif // APP_COMPACT_BOLT_LOCK_EVENTS
+
+// Fields of the BoltLockActorStruct command argument.
+enum
 {
-    Lock();
+    kBoltLockActorField_Method     = 1,
+    kBoltLockActorField_Originator = 2,
+    kBoltLockActorField_Agent      = 3,
+};
 
-    mLockActor     = aLockActor;
-    mActuatorState = BOLT_ACTUATOR_STATE_LOCKING;
-    mState         = BOLT_STATE_EXTENDED;
+BoltLockTraitDataSource::BoltLockTraitDataSource() : TraitDataSource(&BoltLockTrait::TraitSchema)
+{
+    mWorkingState.State         = BOLT_STATE_EXTENDED;
+    mWorkingState.ActuatorState = BOLT_ACTUATOR_STATE_OK;
+    mWorkingState.LockedState   = BOLT_LOCKED_STATE_LOCKED;
+    mWorkingState.LockActor     = BOLT_LOCK_ACTOR_METHOD_PHYSICAL;
+    mWorkingState.Originator    = ActorIdentityTable::kInvalidIndex;
+    mWorkingState.Agent         = ActorIdentityTable::kInvalidIndex;
+
+    mStateBuffers[0]     = mWorkingState;
+    mStateBuffers[1]     = mWorkingState;
+    mFlushedState        = mWorkingState;
+    mActiveStateBuffer   = 0;
+    mStateSequence       = 0;
+    mPendingDirtyHandles = 0;
+
+    mSnapshotVersion    = 0;
+    mIsSnapshotValid    = false;
+    mSnapshotReadCount  = 0;
+    mSnapshotBuildCount = 0;
+
+    mCommandCache.Init();
+
+#if APP_DEFERRED_COMMAND_RESPONSE
+    mPendingCommand = NULL;
+#endif
+}
 
-    SetDirty(BoltLockTrait::kPropertyHandle_State);
-    SetDirty(BoltLockTrait::kPropertyHandle_BoltLockActor_Method);
-    SetDirty(BoltLockTrait::kPropertyHandle_ActuatorState);
+bool BoltLockTraitDataSource::IsLocked()
+{
+    BoltLockState state;
 
-    Unlock();
+    ReadState(state);
 
-    BoltActuatorStateChangeEvent ev;
-    EventOptions options(true);
-    ev.state = BOLT_STATE_EXTENDED;
-    ev.actuatorState = BOLT_ACTUATOR_STATE_LOCKING;
-    ev.lockedState = BOLT_LOCKED_STATE_UNLOCKED;
-    ev.boltLockActor.method = aLockActor;
-    ev.boltLockActor.SetOriginatorNull();
-    ev.boltLockActor.SetAgentNull();
-    nl::LogEvent(&ev, options);
+    return (state.LockedState == BOLT_LOCKED_STATE_LOCKED);
+}
 
-    WdmFeature().ProcessTraitChanges();
+void BoltLockTraitDataSource::InitiateLock(int32_t aLockActor, ActorIdentityTable::Index aOriginator,
+                                           ActorIdentityTable::Index aAgent)
+{
+    SetActor(aLockActor, aOriginator, aAgent);
+    mWorkingState.ActuatorState = BOLT_ACTUATOR_STATE_LOCKING;
+    mWorkingState.State         = BOLT_STATE_EXTENDED;
 
+    PublishState(HandleBit(BoltLockTrait::kPropertyHandle_State) |
+                 HandleBit(BoltLockTrait::kPropertyHandle_BoltLockActor_Method) |
+                 HandleBit(BoltLockTrait::kPropertyHandle_BoltLockActor_Originator) |
+                 HandleBit(BoltLockTrait::kPropertyHandle_BoltLockActor_Agent) |
+                 HandleBit(BoltLockTrait::kPropertyHandle_ActuatorState));
+
+    // The bolt is still unlocked; this goes out with the end of the movement, and so does
+    // the event, which would otherwise force an offload of its own.
+    LogStateChangeEvent(false);
+
+    WdmFeature().ProcessTraitChanges(WDMFeature::kNotifyUrgency_Batched);
 }
 
-void BoltLockTraitDataSource::InitiateUnlock(int32_t aLockActor)
+void BoltLockTraitDataSource::InitiateUnlock(int32_t aLockActor, ActorIdentityTable::Index aOriginator,
+                                             ActorIdentityTable::Index aAgent)
 {
-    Lock();
+    SetActor(aLockActor, aOriginator, aAgent);
+    mWorkingState.ActuatorState = BOLT_ACTUATOR_STATE_UNLOCKING;
+    mWorkingState.LockedState   = BOLT_LOCKED_STATE_UNLOCKED;
 
-    mLockActor     = aLockActor;
-    mActuatorState = BOLT_ACTUATOR_STATE_UNLOCKING;
-    mLockedState   = BOLT_LOCKED_STATE_UNLOCKED;
+    PublishState(HandleBit(BoltLockTrait::kPropertyHandle_BoltLockActor_Method) |
+                 HandleBit(BoltLockTrait::kPropertyHandle_BoltLockActor_Originator) |
+                 HandleBit(BoltLockTrait::kPropertyHandle_BoltLockActor_Agent) |
+                 HandleBit(BoltLockTrait::kPropertyHandle_ActuatorState) |
+                 HandleBit(BoltLockTrait::kPropertyHandle_LockedState) |
+                 HandleBit(BoltLockTrait::kPropertyHandle_LockedStateLastChangedAt));
 
-    SetDirty(BoltLockTrait::kPropertyHandle_BoltLockActor_Method);
-    SetDirty(BoltLockTrait::kPropertyHandle_ActuatorState);
-    SetDirty(BoltLockTrait::kPropertyHandle_LockedState);
-    SetDirty(BoltLockTrait::kPropertyHandle_LockedStateLastChangedAt);
+    LogStateChangeEvent(true);
 
-    Unlock();
+    WdmFeature().ProcessTraitChanges();
+}
 
-    BoltActuatorStateChangeEvent ev;
-    EventOptions options(true);
-    ev.state = BOLT_STATE_EXTENDED;
-    ev.actuatorState = BOLT_ACTUATOR_STATE_UNLOCKING;
-    ev.lockedState = BOLT_LOCKED_STATE_UNLOCKED;
-    ev.boltLockActor.method = aLockActor;
-    ev.boltLockActor.SetOriginatorNull();
-    ev.boltLockActor.SetAgentNull();
-    nl::LogEvent(&ev, options);
+void BoltLockTraitDataSource::LockingSuccessful(void)
+{
+    mWorkingState.ActuatorState = BOLT_ACTUATOR_STATE_OK;
+    mWorkingState.LockedState   = BOLT_LOCKED_STATE_LOCKED;
+
+    PublishState(HandleBit(BoltLockTrait::kPropertyHandle_ActuatorState) |
+                 HandleBit(BoltLockTrait::kPropertyHandle_LockedState) |
+                 HandleBit(BoltLockTrait::kPropertyHandle_LockedStateLastChangedAt));
+
+    LogStateChangeEvent(true);
 
     WdmFeature().ProcessTraitChanges();
+
+#if APP_DEFERRED_COMMAND_RESPONSE
+    CompletePendingCommand();
+#endif
 }
 
-void BoltLockTraitDataSource::LockingSuccessful(void)
+void BoltLockTraitDataSource::UnlockingSuccessful(void)
 {
-    Lock();
+    mWorkingState.State         = BOLT_STATE_RETRACTED;
+    mWorkingState.ActuatorState = BOLT_ACTUATOR_STATE_OK;
 
-    mActuatorState = BOLT_ACTUATOR_STATE_OK;
-    mLockedState   = BOLT_LOCKED_STATE_LOCKED;
+    PublishState(HandleBit(BoltLockTrait::kPropertyHandle_State) |
+                 HandleBit(BoltLockTrait::kPropertyHandle_ActuatorState));
 
-    SetDirty(BoltLockTrait::kPropertyHandle_ActuatorState);
-    SetDirty(BoltLockTrait::kPropertyHandle_LockedState);
-    SetDirty(BoltLockTrait::kPropertyHandle_LockedStateLastChangedAt);
+    // The unlocked state was already reported when the movement started.
+    LogStateChangeEvent(false);
 
-    Unlock();
+    WdmFeature().ProcessTraitChanges(WDMFeature::kNotifyUrgency_Batched);
 
-    BoltActuatorStateChangeEvent ev;
-    EventOptions options(true);
-    ev.state = BOLT_STATE_EXTENDED;
-    ev.actuatorState = BOLT_ACTUATOR_STATE_OK;
-    ev.lockedState = BOLT_LOCKED_STATE_LOCKED;
-    ev.boltLockActor.method = mLockActor;
-    ev.boltLockActor.SetOriginatorNull();
-    ev.boltLockActor.SetAgentNull();
-    nl::LogEvent(&ev, options);
+#if APP_DEFERRED_COMMAND_RESPONSE
+    CompletePendingCommand();
+#endif
+}
 
-    WdmFeature().ProcessTraitChanges();
+void BoltLockTraitDataSource::SetActor(int32_t aLockActor, ActorIdentityTable::Index aOriginator,
+                                       ActorIdentityTable::Index aAgent)
+{
+    // The previous identities stay in the table; dropping their references only makes the
+    // entries reclaimable, and reclaiming happens on the Weave task, which never reads the
+    // state concurrently with itself.
+    ActorIds().Release(mWorkingState.Originator);
+    ActorIds().Release(mWorkingState.Agent);
+
+    mWorkingState.LockActor  = aLockActor;
+    mWorkingState.Originator = aOriginator;
+    mWorkingState.Agent      = aAgent;
 }
 
-void BoltLockTraitDataSource::UnlockingSuccessful(void)
+void BoltLockTraitDataSource::PublishState(uint32_t aDirtyHandles)
+{
+    // Called from the app task, which is the only writer.  The new state is written into the
+    // inactive buffer and then made visible by flipping the active index, so the writer never
+    // waits for a reader.  The sequence number is bumped to odd before the inactive buffer is
+    // touched and back to even once the flip is visible, so a reader whose copy overlaps any
+    // part of a publish sees the sequence change and reads again.
+    uint8_t nextBuffer = mActiveStateBuffer ^ 1;
+
+    __atomic_add_fetch(&mStateSequence, 1, __ATOMIC_RELAXED);
+
+    // Keep the plain stores below from moving ahead of the odd sequence.
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    mStateBuffers[nextBuffer] = mWorkingState;
+
+    __atomic_store_n(&mActiveStateBuffer, nextBuffer, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&mStateSequence, 1, __ATOMIC_RELEASE);
+
+    // The dirty marks are applied on the Weave task (see FlushPendingChanges()), which is also
+    // where the notification engine runs, so the publisher lock is never taken by the app task.
+    __atomic_fetch_or(&mPendingDirtyHandles, aDirtyHandles, __ATOMIC_RELEASE);
+}
+
+void BoltLockTraitDataSource::ReadState(BoltLockState & aState) const
 {
+    uint32_t sequence;
+
+    do
+    {
+        // An odd sequence does not make the reader wait: the active buffer is not written
+        // until after the index flip, which moves the sequence again.  Waiting would spin
+        // forever if this task preempted the app task in the middle of a publish.
+        sequence = __atomic_load_n(&mStateSequence, __ATOMIC_ACQUIRE);
+        aState   = mStateBuffers[__atomic_load_n(&mActiveStateBuffer, __ATOMIC_ACQUIRE)];
+
+        // The copy is made of plain loads; keep them from moving past the sequence check.
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (sequence != __atomic_load_n(&mStateSequence, __ATOMIC_RELAXED));
+}
+
+bool BoltLockTraitDataSource::FlushPendingChanges(void)
+{
+    WEAVE_ERROR err;
+    uint32_t dirtyHandles = __atomic_exchange_n(&mPendingDirtyHandles, 0, __ATOMIC_ACQUIRE);
+
+    if (dirtyHandles == 0)
+    {
+        return false;
+    }
+
+    // The state and its encoding are replaced in the same lock session that moves the data
+    // version, so the notification engine never sees one without the other.  The snapshot is
+    // built here rather than on the first notify: it copies the actor identities, whose table
+    // entries may be reclaimed by the next command.
     Lock();
 
-    mState         = BOLT_STATE_RETRACTED;
-    mActuatorState = BOLT_ACTUATOR_STATE_OK;
+    ReadState(mFlushedState);
 
-    SetDirty(BoltLockTrait::kPropertyHandle_State);
-    SetDirty(BoltLockTrait::kPropertyHandle_ActuatorState);
+    for (PropertyPathHandle handle = BoltLockTrait::kPropertyHandle_Root; handle <= BoltLockTrait::kLastSchemaHandle;
+         handle++)
+    {
+        if (dirtyHandles & HandleBit(handle))
+        {
+            SetDirty(handle);
+        }
+    }
+
+    err = BuildSnapshot();
 
     Unlock();
 
+    if (err == WEAVE_NO_ERROR)
+    {
+        mSnapshotVersion = GetVersion();
+    }
+    else
+    {
+        EFR32_LOG("Failed to build BoltLockTrait snapshot: %s", ::nl::ErrorStr(err));
+    }
+
+    return true;
+}
+
+void BoltLockTraitDataSource::LogStateChangeEvent(bool aIsUrgent)
+{
     BoltActuatorStateChangeEvent ev;
-    EventOptions options(true);
-    ev.state = BOLT_STATE_RETRACTED;
-    ev.actuatorState = BOLT_ACTUATOR_STATE_OK;
-    ev.lockedState = BOLT_LOCKED_STATE_UNLOCKED;
-    ev.boltLockActor.method = mLockActor;
-    ev.boltLockActor.SetOriginatorNull();
-    ev.boltLockActor.SetAgentNull();
-    nl::LogEvent(&ev, options);
 
-    WdmFeature().ProcessTraitChanges();
+    ev.state                = mWorkingState.State;
+    ev.actuatorState        = mWorkingState.ActuatorState;
+    ev.lockedState          = mWorkingState.LockedState;
+    ev.boltLockActor.method = mWorkingState.LockActor;
+
+    SetActorId(ev.boltLockActor.originator, mWorkingState.Originator);
+    if (mWorkingState.Originator != ActorIdentityTable::kInvalidIndex)
+    {
+        ev.boltLockActor.SetOriginatorPresent();
+    }
+    else
+    {
+        ev.boltLockActor.SetOriginatorNull();
+    }
+
+    SetActorId(ev.boltLockActor.agent, mWorkingState.Agent);
+    if (mWorkingState.Agent != ActorIdentityTable::kInvalidIndex)
+    {
+        ev.boltLockActor.SetAgentPresent();
+    }
+    else
+    {
+        ev.boltLockActor.SetAgentNull();
+    }
+
+#if APP_COMPACT_BOLT_LOCK_EVENTS
+    {
+        // Supplying a system timestamp keeps the logger from stamping the event with UTC time.
+        EventOptions options(static_cast<timestamp_t>(System::Platform::Layer::GetClock_MonotonicMS()), aIsUrgent);
+        nl::Weave::Profiles::DataManagement::LogEvent(sCompactStateChangeEventSchema, WriteCompactStateChangeEvent, &ev,
+                                                      &options);
+    }
+#else
+    {
+        EventOptions options(aIsUrgent);
+        nl::LogEvent(&ev, options);
+    }
+#endif
+}
+
+WEAVE_ERROR BoltLockTraitDataSource::BuildSnapshot(void)
+{
+    WEAVE_ERROR err = WEAVE_NO_ERROR;
+    TLVWriter writer;
+    uint32_t offset;
+
+    mIsSnapshotValid = false;
+
+    memset(&mSnapshot, 0, sizeof(mSnapshot));
+    writer.Init(mSnapshot.Data, sizeof(mSnapshot.Data));
+
+    for (PropertyPathHandle handle = BoltLockTrait::kPropertyHandle_State; handle <= BoltLockTrait::kLastSchemaHandle;
+         handle++)
+    {
+        if (handle == BoltLockTrait::kPropertyHandle_BoltLockActor)
+        {
+            continue;
+        }
+
+        offset = writer.GetLengthWritten();
+
+        err = EncodeLeaf(mFlushedState, handle, AnonymousTag, writer);
+        SuccessOrExit(err);
+
+        mSnapshot.Offset[handle] = static_cast<uint8_t>(offset);
+        mSnapshot.Length[handle] = static_cast<uint8_t>(writer.GetLengthWritten() - offset);
+    }
+
+    err = writer.Finalize();
+    SuccessOrExit(err);
+
+    mIsSnapshotValid = true;
+    mSnapshotBuildCount++;
+
+exit:
+    return err;
 }
 
 WEAVE_ERROR BoltLockTraitDataSource::GetLeafData(PropertyPathHandle aLeafHandle, uint64_t aTagToWrite, TLVWriter & aWriter)
 {
     WEAVE_ERROR err = WEAVE_NO_ERROR;
+    TLVReader reader;
 
-    switch (aLeafHandle)
+    // The notification engine asks for every leaf once per subscriber.  The leaves are
+    // encoded once per data version and each subscriber gets a copy of the same bytes.
+    if (!mIsSnapshotValid || mSnapshotVersion != GetVersion())
     {
-        case BoltLockTrait::kPropertyHandle_State:
-            err = aWriter.Put(aTagToWrite, mState);
-            SuccessOrExit(err);
-            break;
+        return EncodeLeaf(mFlushedState, aLeafHandle, aTagToWrite, aWriter);
+    }
 
-        case BoltLockTrait::kPropertyHandle_ActuatorState:
-            err = aWriter.Put(aTagToWrite, mActuatorState);
-            SuccessOrExit(err);
-            break;
+    VerifyOrExit(aLeafHandle <= BoltLockTrait::kLastSchemaHandle && mSnapshot.Length[aLeafHandle] != 0,
+                 err = WEAVE_ERROR_INVALID_ARGUMENT);
 
-        case BoltLockTrait::kPropertyHandle_LockedState:
-            err = aWriter.Put(aTagToWrite, mLockedState);
-            SuccessOrExit(err);
-            break;
+    reader.Init(&mSnapshot.Data[mSnapshot.Offset[aLeafHandle]], mSnapshot.Length[aLeafHandle]);
 
-        case BoltLockTrait::kPropertyHandle_BoltLockActor_Method:
-            err = aWriter.Put(aTagToWrite, mLockActor);
-            SuccessOrExit(err);
-            break;
+    err = reader.Next();
+    SuccessOrExit(err);
+
+    err = aWriter.CopyElement(aTagToWrite, reader);
+    SuccessOrExit(err);
+
+    mSnapshotReadCount++;
+
+exit:
+    return err;
+}
+
+WEAVE_ERROR BoltLockTraitDataSource::EncodeLeaf(const BoltLockState & aState, PropertyPathHandle aLeafHandle,
+                                                uint64_t aTagToWrite, TLVWriter & aWriter)
+{
+    WEAVE_ERROR err = WEAVE_NO_ERROR;
 
+    if (sBoltLockLeafTable.IsFieldLeaf(aLeafHandle))
+    {
+        return sBoltLockLeafTable.WriteLeaf(aState, aLeafHandle, aTagToWrite, aWriter);
+    }
+
+    switch (aLeafHandle)
+    {
         case BoltLockTrait::kPropertyHandle_LockedStateLastChangedAt:
         {
             uint64_t currentTime = 0;
@@ -201,8 +525,12 @@ WEAVE_ERROR BoltLockTraitDataSource::GetLeafData(PropertyPathHandle aLeafHandle,
         }
 
         case BoltLockTrait::kPropertyHandle_BoltLockActor_Originator:
+            err = PutActorId(aWriter, aTagToWrite, aState.Originator);
+            SuccessOrExit(err);
+            break;
+
         case BoltLockTrait::kPropertyHandle_BoltLockActor_Agent:
-            err = aWriter.PutNull(aTagToWrite);
+            err = PutActorId(aWriter, aTagToWrite, aState.Agent);
             SuccessOrExit(err);
             break;
 
@@ -224,6 +552,54 @@ void BoltLockTraitDataSource::OnCustomCommand(nl::Weave::Profiles::DataManagemen
     WEAVE_ERROR err           = WEAVE_NO_ERROR;
     uint32_t reportProfileId  = nl::Weave::Profiles::kWeaveProfile_Common;
     uint16_t reportStatusCode = nl::Weave::Profiles::Common::kStatus_BadRequest;
+    ActorIdentityTable::Index changeRequestParam_Originator = ActorIdentityTable::kInvalidIndex;
+    ActorIdentityTable::Index changeRequestParam_Agent      = ActorIdentityTable::kInvalidIndex;
+    const CommandResponseCache::Entry * cachedEntry = NULL;
+    CommandResponseCache::Key commandKey;
+    bool isCacheable;
+    uint64_t dispatchedMS = System::Platform::Layer::GetClock_MonotonicMS();
+
+    // Lock commands are interactive; bulk traffic gives way until the exchange is over.
+    WdmFeature().GetTrafficScheduler().OnInteractiveExchange();
+
+    // A retry of a command that has already been processed is answered from the cache
+    // without touching the lock.
+    isCacheable = CommandResponseCache::MakeKey(aMsgInfo->SourceNodeId, aCommandType, aIsExpiryTimeValid,
+                                                aExpiryTimeMicroSecond, aIsMustBeVersionValid, aMustBeVersion, commandKey);
+    if (isCacheable)
+    {
+        cachedEntry = mCommandCache.Find(commandKey);
+    }
+
+    if (cachedEntry != NULL)
+    {
+        EFR32_LOG("Duplicate BoltLockChangeRequest Command (%" PRIu32 " duplicates in %" PRIu32 " commands)",
+                  mCommandCache.GetHitCount(), mCommandCache.GetLookupCount());
+        SendCachedResponse(aCommand, *cachedEntry);
+        aCommand = NULL;
+        ExitNow();
+    }
+
+    // Checkpoints the session's receive counter once the command has been handled.
+    WdmFeature().GetServiceSessionStore().OnMessageReceived(aMsgInfo->KeyId);
+
+#if APP_DEFERRED_COMMAND_RESPONSE
+    // Only one command is held at a time.  A retry of the held command is dropped, since the
+    // response to the original will answer it; any other command is turned away.
+    if (mPendingCommand != NULL)
+    {
+        if (isCacheable && mIsPendingKeyValid && commandKey.Matches(mPendingKey))
+        {
+            EFR32_LOG("Retry of pending BoltLockChangeRequest Command dropped");
+            aCommand->Close();
+            aCommand = NULL;
+            ExitNow();
+        }
+
+        reportStatusCode = nl::Weave::Profiles::Common::kStatus_Busy;
+        ExitNow(err = WEAVE_ERROR_INCORRECT_STATE);
+    }
+#endif
 
     if (aIsMustBeVersionValid)
     {
@@ -240,9 +616,10 @@ void BoltLockTraitDataSource::OnCustomCommand(nl::Weave::Profiles::DataManagemen
     {
         reportProfileId = nl::Weave::Profiles::kWeaveProfile_WDM;
 #if WEAVE_DEVICE_CONFIG_ENABLE_WEAVE_TIME_SERVICE_TIME_SYNC
-        uint64_t currentTime;
-        err = System::Platform::Layer::GetClock_RealTimeMS(currentTime);
-        if (err == WEAVE_SYSTEM_ERROR_REAL_TIME_NOT_SYNCED)
+        // The expiry checker falls back on the monotonic clock while the real-time clock is
+        // not synchronized, so commands can be accepted before the first sync after boot.
+        CommandExpiryChecker::Result expiryResult = ExpiryChecker().Check(aExpiryTimeMicroSecond);
+        if (expiryResult == CommandExpiryChecker::kResult_TimeUnknown)
         {
             EFR32_LOG("BoltLockChangeRequest Command failed!");
             reportStatusCode = kStatus_NotTimeSyncedYet;
@@ -251,7 +628,7 @@ void BoltLockTraitDataSource::OnCustomCommand(nl::Weave::Profiles::DataManagemen
 
         // If we have already passed the commands expiration time,
         // error out
-        if (aExpiryTimeMicroSecond < static_cast<int64_t>(currentTime))
+        if (expiryResult == CommandExpiryChecker::kResult_Expired)
         {
             EFR32_LOG("BoltLockChangeRequest Command Expired!");
             reportStatusCode = kStatus_RequestExpiredInTime;
@@ -270,7 +647,7 @@ void BoltLockTraitDataSource::OnCustomCommand(nl::Weave::Profiles::DataManagemen
 
     {
         int32_t changeRequestParam_State;
-        int32_t changeRequestParam_Actor;
+        int32_t changeRequestParam_Actor = 0;
         nl::Weave::TLV::TLVType OuterContainerType;
         err = aArgumentReader.EnterContainer(OuterContainerType);
         SuccessOrExit(err);
@@ -287,15 +664,41 @@ void BoltLockTraitDataSource::OnCustomCommand(nl::Weave::Profiles::DataManagemen
 
                 case kBoltLockChangeRequestParameter_BoltLockActor:
                 {
-                    WEAVE_ERROR err;
                     nl::Weave::TLV::TLVType InnerContainerType;
                     err = aArgumentReader.EnterContainer(InnerContainerType);
                     SuccessOrExit(err);
 
-                    err = aArgumentReader.Next();
-                    SuccessOrExit(err);
-
-                    err = aArgumentReader.Get(changeRequestParam_Actor);
+                    while (WEAVE_NO_ERROR == (err = aArgumentReader.Next()))
+                    {
+                        VerifyOrExit(nl::Weave::TLV::IsContextTag(aArgumentReader.GetTag()),
+                                     err = WEAVE_ERROR_INVALID_TLV_TAG);
+                        switch (nl::Weave::TLV::TagNumFromTag(aArgumentReader.GetTag()))
+                        {
+                            case kBoltLockActorField_Method:
+                                err = aArgumentReader.Get(changeRequestParam_Actor);
+                                SuccessOrExit(err);
+                                break;
+
+                            case kBoltLockActorField_Originator:
+                                err = InternActorId(aArgumentReader, changeRequestParam_Originator);
+                                SuccessOrExit(err);
+                                break;
+
+                            case kBoltLockActorField_Agent:
+                                err = InternActorId(aArgumentReader, changeRequestParam_Agent);
+                                SuccessOrExit(err);
+                                break;
+
+                            default:
+                                EFR32_LOG("Unexpected BoltLockActor Tag in CustomCommand");
+                                ExitNow(err = WEAVE_ERROR_INVALID_TLV_TAG);
+                        }
+                    }
+
+                    if (WEAVE_END_OF_TLV == err)
+                    {
+                        err = WEAVE_NO_ERROR;
+                    }
                     SuccessOrExit(err);
 
                     err = aArgumentReader.ExitContainer(InnerContainerType);
@@ -316,13 +719,33 @@ void BoltLockTraitDataSource::OnCustomCommand(nl::Weave::Profiles::DataManagemen
         }
         SuccessOrExit(err);
 
-        if (changeRequestParam_State == BOLT_STATE_RETRACTED)
+        // The method is published as a BoltLockActorMethod, and packed into four bits of the compact event.
+        if (changeRequestParam_Actor < BOLT_LOCK_ACTOR_METHOD_OTHER ||
+            changeRequestParam_Actor > BOLT_LOCK_ACTOR_METHOD_VOICE_ASSISTANT)
         {
-            GetAppTask().PostLockActionRequest(changeRequestParam_Actor, BoltLockManager::UNLOCK_ACTION);
+            EFR32_LOG("Invalid BoltLockActor method %" PRId32 " in CustomCommand", changeRequestParam_Actor);
+            reportProfileId  = nl::Weave::Profiles::kWeaveProfile_Common;
+            reportStatusCode = nl::Weave::Profiles::Common::kStatus_BadRequest;
+            ExitNow(err = WEAVE_ERROR_INVALID_ARGUMENT);
         }
-        else if (changeRequestParam_State == BOLT_STATE_EXTENDED)
+
+        if (changeRequestParam_State == BOLT_STATE_RETRACTED || changeRequestParam_State == BOLT_STATE_EXTENDED)
         {
-            GetAppTask().PostLockActionRequest(changeRequestParam_Actor, BoltLockManager::LOCK_ACTION);
+            BoltLockManager::Action_t action = (changeRequestParam_State == BOLT_STATE_RETRACTED)
+                ? BoltLockManager::UNLOCK_ACTION
+                : BoltLockManager::LOCK_ACTION;
+
+            if (!GetAppTask().PostLockActionRequest(changeRequestParam_Actor, changeRequestParam_Originator,
+                                                    changeRequestParam_Agent, action))
+            {
+                reportProfileId  = nl::Weave::Profiles::kWeaveProfile_Common;
+                reportStatusCode = nl::Weave::Profiles::Common::kStatus_OutOfMemory;
+                ExitNow(err = WEAVE_ERROR_NO_MEMORY);
+            }
+
+            // The identity references now travel with the request.
+            changeRequestParam_Originator = ActorIdentityTable::kInvalidIndex;
+            changeRequestParam_Agent      = ActorIdentityTable::kInvalidIndex;
         }
         else
         {
@@ -339,6 +762,19 @@ void BoltLockTraitDataSource::OnCustomCommand(nl::Weave::Profiles::DataManagemen
     {
         EFR32_LOG("BoltLockChangeRequest Command Parsed!");
 
+#if APP_DEFERRED_COMMAND_RESPONSE
+        // Hold on to the command; it is answered once the bolt has stopped moving.
+        mPendingCommand     = aCommand;
+        mPendingKey         = commandKey;
+        mIsPendingKeyValid  = isCacheable;
+        mPendingStartTimeMS = dispatchedMS;
+        aCommand            = NULL;
+
+        nl::Weave::DeviceLayer::SystemLayer.StartTimer(APP_DEFERRED_COMMAND_RESPONSE_TIMEOUT_MS, HandlePendingCommandTimeout,
+                                                       this);
+        ExitNow();
+#endif
+
         PacketBuffer * msgBuf = PacketBuffer::New();
         if (NULL == msgBuf)
         {
@@ -351,6 +787,13 @@ void BoltLockTraitDataSource::OnCustomCommand(nl::Weave::Profiles::DataManagemen
         aCommand->SendResponse(GetVersion(), msgBuf);
         aCommand = NULL;
         msgBuf   = NULL;
+
+        WdmFeature().GetTrafficScheduler().OnCommandResponse(dispatchedMS);
+
+        if (isCacheable)
+        {
+            mCommandCache.AddSuccess(commandKey, GetVersion());
+        }
     }
     else
     {
@@ -360,6 +803,18 @@ void BoltLockTraitDataSource::OnCustomCommand(nl::Weave::Profiles::DataManagemen
 exit:
     if (NULL != aCommand)
     {
+        // Transient failures are not remembered, so a retry of the same command is evaluated afresh.
+        bool isTransientError =
+            (reportProfileId == nl::Weave::Profiles::kWeaveProfile_WDM && reportStatusCode == kStatus_NotTimeSyncedYet) ||
+            (reportProfileId == nl::Weave::Profiles::kWeaveProfile_Common &&
+             (reportStatusCode == nl::Weave::Profiles::Common::kStatus_OutOfMemory ||
+              reportStatusCode == nl::Weave::Profiles::Common::kStatus_Busy));
+
+        if (isCacheable && !isTransientError)
+        {
+            mCommandCache.AddError(commandKey, reportProfileId, reportStatusCode);
+        }
+
         aCommand->SendError(reportProfileId, reportStatusCode, err);
         aCommand = NULL;
     }
@@ -369,4 +824,200 @@ exit:
         PacketBuffer::Free(aPayload);
         aPayload = NULL;
     }
+
+    ActorIds().Release(changeRequestParam_Originator);
+    ActorIds().Release(changeRequestParam_Agent);
+}
+
+WEAVE_ERROR BoltLockTraitDataSource::InternActorId(TLVReader & aReader, ActorIdentityTable::Index & aIndex)
+{
+    WEAVE_ERROR err = WEAVE_NO_ERROR;
+    const uint8_t * id;
+
+    // A repeated field replaces the earlier value.
+    ActorIds().Release(aIndex);
+    aIndex = ActorIdentityTable::kInvalidIndex;
+
+    if (aReader.GetType() == kTLVType_Null)
+    {
+        ExitNow();
+    }
+
+    VerifyOrExit(aReader.GetType() == kTLVType_ByteString, err = WEAVE_ERROR_WRONG_TLV_TYPE);
+    VerifyOrExit(aReader.GetLength() <= ActorIdentityTable::kMaxIdLength, err = WEAVE_ERROR_INVALID_ARGUMENT);
+
+    err = aReader.GetDataPtr(id);
+    SuccessOrExit(err);
+
+    aIndex = ActorIds().Intern(id, aReader.GetLength());
+    if (aIndex == ActorIdentityTable::kInvalidIndex)
+    {
+        // Every entry is in use; the action is still carried out, with the identity recorded as null.
+        EFR32_LOG("Actor identity table full");
+    }
+
+exit:
+    return err;
+}
+
+WEAVE_ERROR BoltLockTraitDataSource::PutActorId(TLVWriter & aWriter, uint64_t aTag, ActorIdentityTable::Index aIndex)
+{
+    const uint8_t * id;
+    uint8_t len;
+
+    id = ActorIds().Get(aIndex, len);
+    if (id == NULL)
+    {
+        return aWriter.PutNull(aTag);
+    }
+
+    return aWriter.PutBytes(aTag, id, len);
+}
+
+void BoltLockTraitDataSource::SetActorId(nl::SerializedByteString & aId, ActorIdentityTable::Index aIndex)
+{
+    uint8_t len;
+
+    aId.mBuf = const_cast<uint8_t *>(ActorIds().Get(aIndex, len));
+    aId.mLen = len;
+}
+
+void BoltLockTraitDataSource::SendCachedResponse(nl::Weave::Profiles::DataManagement::Command * aCommand,
+                                                 const CommandResponseCache::Entry & aEntry)
+{
+    if (aEntry.IsSuccess)
+    {
+        PacketBuffer * msgBuf = PacketBuffer::New();
+        if (NULL != msgBuf)
+        {
+            aCommand->SendResponse(aEntry.ResponseVersion, msgBuf);
+            return;
+        }
+
+        aCommand->SendError(nl::Weave::Profiles::kWeaveProfile_Common, nl::Weave::Profiles::Common::kStatus_OutOfMemory,
+                            WEAVE_ERROR_NO_MEMORY);
+    }
+    else
+    {
+        aCommand->SendError(aEntry.StatusProfileId, aEntry.StatusCode, WEAVE_NO_ERROR);
+    }
+}
+
+#if APP_DEFERRED_COMMAND_RESPONSE
+
+void BoltLockTraitDataSource::CompletePendingCommand(void)
+{
+    // Called from the app task; the command itself is only touched on the Weave task.
+    nl::Weave::DeviceLayer::PlatformMgr().ScheduleWork(AsyncCompletePendingCommand, reinterpret_cast<intptr_t>(this));
+}
+
+void BoltLockTraitDataSource::AsyncCompletePendingCommand(intptr_t arg)
+{
+    reinterpret_cast<BoltLockTraitDataSource *>(arg)->FinishPendingCommand(false);
+}
+
+void BoltLockTraitDataSource::HandlePendingCommandTimeout(System::Layer * aLayer, void * aAppState, System::Error aError)
+{
+    static_cast<BoltLockTraitDataSource *>(aAppState)->FinishPendingCommand(true);
+}
+
+void BoltLockTraitDataSource::FinishPendingCommand(bool aTimedOut)
+{
+    WEAVE_ERROR err       = WEAVE_NO_ERROR;
+    PacketBuffer * msgBuf = NULL;
+    uint32_t durationMS;
+
+    if (mPendingCommand == NULL)
+    {
+        return;
+    }
+
+    nl::Weave::DeviceLayer::SystemLayer.CancelTimer(HandlePendingCommandTimeout, this);
+
+    durationMS = static_cast<uint32_t>(System::Platform::Layer::GetClock_MonotonicMS() - mPendingStartTimeMS);
+
+    if (aTimedOut)
+    {
+        EFR32_LOG("BoltLockChangeRequest Command timed out after %" PRIu32 " ms", durationMS);
+        ExitNow(err = WEAVE_ERROR_TIMEOUT);
+    }
+
+    // Allocated like the immediate response: Command::SendResponse() adds the custom command
+    // response header around the payload, in space that a buffer sized for the payload alone
+    // does not have.
+    msgBuf = PacketBuffer::New();
+    VerifyOrExit(NULL != msgBuf, err = WEAVE_ERROR_NO_MEMORY);
+
+    err = EncodeCommandResponse(msgBuf, durationMS);
+    SuccessOrExit(err);
+
+    EFR32_LOG("Sending Completion Response to BoltLockChangeRequest Command (%" PRIu32 " ms)", durationMS);
+    mPendingCommand->SendResponse(GetVersion(), msgBuf);
+    msgBuf = NULL;
+
+    WdmFeature().GetTrafficScheduler().OnCommandResponse(mPendingStartTimeMS);
+
+    if (mIsPendingKeyValid)
+    {
+        mCommandCache.AddSuccess(mPendingKey, GetVersion());
+    }
+
+exit:
+    if (err == WEAVE_ERROR_TIMEOUT)
+    {
+        mPendingCommand->SendError(nl::Weave::Profiles::kWeaveProfile_Common, nl::Weave::Profiles::Common::kStatus_Timeout,
+                                   err);
+    }
+    else if (err != WEAVE_NO_ERROR)
+    {
+        mPendingCommand->SendError(nl::Weave::Profiles::kWeaveProfile_Common,
+                                   nl::Weave::Profiles::Common::kStatus_OutOfMemory, err);
+    }
+
+    if (msgBuf)
+    {
+        PacketBuffer::Free(msgBuf);
+    }
+
+    mPendingCommand = NULL;
 }
+
+WEAVE_ERROR BoltLockTraitDataSource::EncodeCommandResponse(PacketBuffer * aBuf, uint32_t aDurationMS)
+{
+    WEAVE_ERROR err = WEAVE_NO_ERROR;
+    TLVWriter writer;
+    TLVType containerType;
+    BoltLockState state;
+
+    ReadState(state);
+
+    writer.Init(aBuf);
+
+    err = writer.StartContainer(AnonymousTag, kTLVType_Structure, containerType);
+    SuccessOrExit(err);
+
+    err = writer.Put(ContextTag(kBoltLockChangeResponseParameter_State), state.State);
+    SuccessOrExit(err);
+
+    err = writer.Put(ContextTag(kBoltLockChangeResponseParameter_ActuatorState), state.ActuatorState);
+    SuccessOrExit(err);
+
+    err = writer.Put(ContextTag(kBoltLockChangeResponseParameter_LockedState), state.LockedState);
+    SuccessOrExit(err);
+
+    err = writer.Put(ContextTag(kBoltLockChangeResponseParameter_DurationMS), aDurationMS);
+    SuccessOrExit(err);
+
+    err = writer.EndContainer(containerType);
+    SuccessOrExit(err);
+
+    err = writer.Finalize();
+    SuccessOrExit(err);
+
+    VerifyOrExit(aBuf->DataLength() <= kMaxBoltLockChangeResponseSize, err = WEAVE_ERROR_BUFFER_TOO_SMALL);
+
+exit:
+    return err;
+}
+
+#endif // APP_DEFERRED_COMMAND_RESPONSE
@@ -27,14 +27,105 @@
 #include <traits/include/DeviceIdentityTraitDataSource.h>
 #include <schema/include/DeviceIdentityTrait.h>
 
+#include "AppConfig.h"
+
+#include <string.h>
+
 using namespace ::nl::Weave::Profiles::DataManagement_Current;
 using namespace ::nl::Weave::TLV;
 using namespace ::nl::Weave::DeviceLayer;
 using namespace ::Schema::Weave::Trait::Description;
 
-DeviceIdentityTraitDataSource::DeviceIdentityTraitDataSource(void) : TraitDataSource(&DeviceIdentityTrait::TraitSchema) { }
+DeviceIdentityTraitDataSource::DeviceIdentityTraitDataSource(void) :
+    TraitDataSource(&DeviceIdentityTrait::TraitSchema), mIsSnapshotValid(false)
+{ }
+
+WEAVE_ERROR DeviceIdentityTraitDataSource::Init(void)
+{
+    PlatformMgr().AddEventHandler(HandlePlatformEvent, reinterpret_cast<intptr_t>(this));
+
+    return BuildSnapshot();
+}
+
+void DeviceIdentityTraitDataSource::HandlePlatformEvent(const WeaveDeviceEvent * event, intptr_t arg)
+{
+    DeviceIdentityTraitDataSource * _this = reinterpret_cast<DeviceIdentityTraitDataSource *>(arg);
+
+    if (event->Type == DeviceEventType::kFabricMembershipChange)
+    {
+        _this->BuildSnapshot();
+
+        _this->Lock();
+        _this->SetDirty(DeviceIdentityTrait::kPropertyHandle_DeviceId);
+        _this->SetDirty(DeviceIdentityTrait::kPropertyHandle_FabricId);
+        _this->Unlock();
+    }
+}
+
+WEAVE_ERROR DeviceIdentityTraitDataSource::BuildSnapshot(void)
+{
+    WEAVE_ERROR err = WEAVE_NO_ERROR;
+    TLVWriter writer;
+    uint32_t offset;
+
+    mIsSnapshotValid = false;
+    memset(&mSnapshot, 0, sizeof(mSnapshot));
+
+    writer.Init(mSnapshot.Data, sizeof(mSnapshot.Data));
+
+    for (PropertyPathHandle handle = DeviceIdentityTrait::kPropertyHandle_VendorId;
+         handle <= DeviceIdentityTrait::kLastSchemaHandle; handle++)
+    {
+        offset = writer.GetLengthWritten();
+
+        err = EncodeLeaf(handle, AnonymousTag, writer);
+        SuccessOrExit(err);
+
+        mSnapshot.Offset[handle] = static_cast<uint8_t>(offset);
+        mSnapshot.Length[handle] = static_cast<uint8_t>(writer.GetLengthWritten() - offset);
+    }
+
+    err = writer.Finalize();
+    SuccessOrExit(err);
+
+    mIsSnapshotValid = true;
+
+    EFR32_LOG("DeviceIdentity snapshot built (%" PRIu32 " bytes)", writer.GetLengthWritten());
+
+exit:
+    if (err != WEAVE_NO_ERROR)
+    {
+        // GetLeafData() falls back on reading the configuration manager directly.
+        EFR32_LOG("Failed to build DeviceIdentity snapshot: %s", ::nl::ErrorStr(err));
+    }
+    return err;
+}
 
 WEAVE_ERROR DeviceIdentityTraitDataSource::GetLeafData(PropertyPathHandle aLeafHandle, uint64_t aTagToWrite, TLVWriter & aWriter)
+{
+    WEAVE_ERROR err = WEAVE_NO_ERROR;
+    TLVReader reader;
+
+    if (!mIsSnapshotValid || aLeafHandle >= kNumHandles)
+    {
+        return EncodeLeaf(aLeafHandle, aTagToWrite, aWriter);
+    }
+
+    VerifyOrExit(mSnapshot.Length[aLeafHandle] != 0, err = WEAVE_NO_ERROR);
+
+    reader.Init(&mSnapshot.Data[mSnapshot.Offset[aLeafHandle]], mSnapshot.Length[aLeafHandle]);
+
+    err = reader.Next();
+    SuccessOrExit(err);
+
+    err = aWriter.CopyElement(aTagToWrite, reader);
+    SuccessOrExit(err);
+
+exit:
+    return err;
+}
+
+WEAVE_ERROR DeviceIdentityTraitDataSource::EncodeLeaf(PropertyPathHandle aLeafHandle, uint64_t aTagToWrite, TLVWriter & aWriter)
 {
     WEAVE_ERROR err = WEAVE_NO_ERROR;
 
@@ -96,18 +187,14 @@ WEAVE_ERROR DeviceIdentityTraitDataSource::GetLeafData(PropertyPathHandle aLeafH
 
         case DeviceIdentityTrait::kPropertyHandle_ManufacturingDate:
         {
-            enum
-            {
-                kDateStrLen = 10 // YYYY-MM-DD
-            };
-            char mfgDateStr[kDateStrLen + 1];
+            char mfgDateStr[kManufacturingDateLength + 1];
             uint16_t year;
             uint8_t month, dayOfMonth;
             err = ConfigurationMgr().GetManufacturingDate(year, month, dayOfMonth);
             VerifyOrExit(err != WEAVE_DEVICE_ERROR_CONFIG_NOT_FOUND, err = WEAVE_NO_ERROR);
             SuccessOrExit(err);
             snprintf(mfgDateStr, sizeof(mfgDateStr), "%04" PRIu16 "-%02" PRIu8 "-%02" PRIu8, year, month, dayOfMonth);
-            err = aWriter.PutString(aTagToWrite, mfgDateStr, kDateStrLen);
+            err = aWriter.PutString(aTagToWrite, mfgDateStr, kManufacturingDateLength);
             SuccessOrExit(err);
             break;
         }
@@ -0,0 +1,187 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/**
+ *    @file
+ *      A trait data source publishing the service subscription metrics.
+ *
+ */
+
+#include <traits/include/SubscriptionDiagnosticsTraitDataSource.h>
+#include <schema/include/SubscriptionDiagnosticsTrait.h>
+#include <WDMFeature.h>
+
+#include "AppConfig.h"
+
+using namespace ::nl::Weave;
+using namespace ::nl::Weave::Profiles::DataManagement_Current;
+using namespace ::nl::Weave::TLV;
+using namespace ::Schema::Example::Trait::Diagnostics;
+
+SubscriptionDiagnosticsTraitDataSource::SubscriptionDiagnosticsTraitDataSource(
+    const SubscriptionMetrics & aMetrics, const RttEstimator & aServiceRtt) :
+    TraitDataSource(&SubscriptionDiagnosticsTrait::TraitSchema),
+    mMetrics(aMetrics), mServiceRtt(aServiceRtt)
+{ }
+
+WEAVE_ERROR SubscriptionDiagnosticsTraitDataSource::Init(void)
+{
+    return DeviceLayer::SystemLayer.StartTimer(APP_SUBSCRIPTION_DIAGNOSTICS_PUBLISH_INTERVAL_MS, HandlePublishTimer,
+                                               this);
+}
+
+void SubscriptionDiagnosticsTraitDataSource::HandlePublishTimer(System::Layer * aLayer, void * aAppState,
+                                                                System::Error aError)
+{
+    SubscriptionDiagnosticsTraitDataSource * _this = static_cast<SubscriptionDiagnosticsTraitDataSource *>(aAppState);
+
+    _this->Lock();
+    _this->SetDirty(kRootPropertyPathHandle);
+    _this->Unlock();
+
+    _this->mMetrics.Log();
+
+    WdmFeature().ProcessTraitChanges(WDMFeature::kNotifyUrgency_Batched);
+
+    aLayer->StartTimer(APP_SUBSCRIPTION_DIAGNOSTICS_PUBLISH_INTERVAL_MS, HandlePublishTimer, _this);
+}
+
+WEAVE_ERROR SubscriptionDiagnosticsTraitDataSource::PutHistogram(TLVWriter & aWriter, uint64_t aTag,
+                                                                 const SubscriptionMetrics::Histogram & aHistogram)
+{
+    WEAVE_ERROR err;
+    TLVType outerType;
+
+    err = aWriter.StartContainer(aTag, kTLVType_Array, outerType);
+    SuccessOrExit(err);
+
+    for (uint8_t i = 0; i < SubscriptionMetrics::kNumHistogramBuckets; i++)
+    {
+        err = aWriter.Put(AnonymousTag, aHistogram.Counts[i]);
+        SuccessOrExit(err);
+    }
+
+    err = aWriter.EndContainer(outerType);
+
+exit:
+    return err;
+}
+
+WEAVE_ERROR SubscriptionDiagnosticsTraitDataSource::GetLeafData(PropertyPathHandle aLeafHandle, uint64_t aTagToWrite,
+                                                                TLVWriter & aWriter)
+{
+    WEAVE_ERROR err = WEAVE_NO_ERROR;
+    TLVType outerType;
+
+    switch (aLeafHandle)
+    {
+        case SubscriptionDiagnosticsTrait::kPropertyHandle_SubscribeLatency:
+            err = PutHistogram(aWriter, aTagToWrite, mMetrics.GetSubscribeLatency());
+            break;
+
+        case SubscriptionDiagnosticsTrait::kPropertyHandle_CounterSubscribeLatency:
+            err = PutHistogram(aWriter, aTagToWrite, mMetrics.GetCounterSubscribeLatency());
+            break;
+
+        case SubscriptionDiagnosticsTrait::kPropertyHandle_NotifyRoundTripTime:
+            err = PutHistogram(aWriter, aTagToWrite, mMetrics.GetNotifyRoundTripTime());
+            break;
+
+        case SubscriptionDiagnosticsTrait::kPropertyHandle_ResubscribeAttempts:
+            err = aWriter.Put(aTagToWrite, mMetrics.GetResubscribeAttempts());
+            break;
+
+        case SubscriptionDiagnosticsTrait::kPropertyHandle_ResubscribeCauses:
+        {
+            err = aWriter.StartContainer(aTagToWrite, kTLVType_Array, outerType);
+            SuccessOrExit(err);
+
+            for (uint8_t cause = 0; cause < SubscriptionMetrics::kResubscribeCause_Max; cause++)
+            {
+                err = aWriter.Put(AnonymousTag, mMetrics.GetResubscribeCauseCount(
+                                                    static_cast<SubscriptionMetrics::ResubscribeCause>(cause)));
+                SuccessOrExit(err);
+            }
+
+            err = aWriter.EndContainer(outerType);
+            break;
+        }
+
+        case SubscriptionDiagnosticsTrait::kPropertyHandle_TerminationReasons:
+        {
+            err = aWriter.StartContainer(aTagToWrite, kTLVType_Array, outerType);
+            SuccessOrExit(err);
+
+            for (uint8_t i = 0; i < mMetrics.GetNumTerminationReasons(); i++)
+            {
+                const SubscriptionMetrics::TerminationReason & reason = mMetrics.GetTerminationReason(i);
+                TLVType structType;
+
+                err = aWriter.StartContainer(AnonymousTag, kTLVType_Structure, structType);
+                SuccessOrExit(err);
+
+                err = aWriter.Put(ContextTag(SubscriptionDiagnosticsTrait::kTerminationReason_ProfileId),
+                                  reason.ProfileId);
+                SuccessOrExit(err);
+
+                err = aWriter.Put(ContextTag(SubscriptionDiagnosticsTrait::kTerminationReason_StatusCode),
+                                  reason.StatusCode);
+                SuccessOrExit(err);
+
+                err = aWriter.Put(ContextTag(SubscriptionDiagnosticsTrait::kTerminationReason_Count), reason.Count);
+                SuccessOrExit(err);
+
+                err = aWriter.EndContainer(structType);
+                SuccessOrExit(err);
+            }
+
+            err = aWriter.EndContainer(outerType);
+            break;
+        }
+
+        case SubscriptionDiagnosticsTrait::kPropertyHandle_TerminationReasonsDropped:
+            err = aWriter.Put(aTagToWrite, mMetrics.GetTerminationReasonsDropped());
+            break;
+
+        case SubscriptionDiagnosticsTrait::kPropertyHandle_SmoothedRtt:
+            err = aWriter.Put(aTagToWrite, mServiceRtt.GetSmoothedRttMS());
+            break;
+
+        case SubscriptionDiagnosticsTrait::kPropertyHandle_RttVariance:
+            err = aWriter.Put(aTagToWrite, mServiceRtt.GetRttVarianceMS());
+            break;
+
+        case SubscriptionDiagnosticsTrait::kPropertyHandle_RetransmitTimeout:
+            err = aWriter.Put(aTagToWrite, mServiceRtt.GetRetransTimeoutMS());
+            break;
+
+        case SubscriptionDiagnosticsTrait::kPropertyHandle_RttSamples:
+            err = aWriter.Put(aTagToWrite, mServiceRtt.GetSampleCount());
+            break;
+
+        case SubscriptionDiagnosticsTrait::kPropertyHandle_RttSamplesDiscarded:
+            err = aWriter.Put(aTagToWrite, mServiceRtt.GetDiscardedSampleCount());
+            break;
+
+        default:
+            break;
+    }
+
+exit:
+    return err;
+}
@@ -32,9 +32,38 @@ class BoltLockSettingsTraitDataSink : public nl::Weave::Profiles::DataManagement
 public:
     BoltLockSettingsTraitDataSink();
 
+    // Restores the settings (and their data version) persisted by a previous boot and
+    // applies them to the lock, so auto-relock works before the service is reachable.
+    WEAVE_ERROR Init(void);
+
 private:
+    // Settings as stored in NVM3.  The layout must not change without changing the key.
+    struct PersistedSettings
+    {
+        uint64_t DataVersion;
+        uint32_t AutoRelockDuration;
+        uint8_t AutoRelockOn;
+        uint8_t Reserved[3];
+    };
+
     WEAVE_ERROR SetLeafData(nl::Weave::Profiles::DataManagement::PropertyPathHandle aLeafHandle,
                             nl::Weave::TLV::TLVReader & aReader);
+    WEAVE_ERROR OnEvent(uint16_t aType, void * aInEventParam);
+
+    void CommitStagedSettings(void);
+    void PersistSettings(void);
+
+    // Settings last handed to the lock manager.
+    bool mAutoRelockOn;
+    uint32_t mAutoRelockDuration;
+
+    // Settings received in the notify being processed, applied together when it ends.
+    bool mStagedAutoRelockOn;
+    uint32_t mStagedAutoRelockDuration;
+    bool mHasStagedChanges;
+
+    bool mIsPersistedVersionValid;
+    uint64_t mPersistedVersion;
 };
 
 #endif /* BOLT_LOCK_SETTINGS_TRAIT_DATA_SINK_H */
@@ -27,18 +27,81 @@
 
 #include <Weave/Profiles/data-management/DataManagement.h>
 
+#include "AppConfig.h"
+#include "CommandResponseCache.h"
+#include "ActorIdentityTable.h"
+#include "TLVSize.h"
+
+#include <schema/include/BoltLockTrait.h>
+
 class BoltLockTraitDataSource : public nl::Weave::Profiles::DataManagement::TraitDataSource
 {
 public:
+    // The trait state, as published by the app task.
+    struct BoltLockState
+    {
+        int32_t State;
+        int32_t ActuatorState;
+        int32_t LockedState;
+        int32_t LockActor;
+        ActorIdentityTable::Index Originator;
+        ActorIdentityTable::Index Agent;
+    };
+
+    // Worst-case encoded sizes, from the BoltLockTrait schema.
+    enum
+    {
+        kMaxBoltLockActorSize =
+            TLVSize::Structure(TLVSize::Int32() + 2 * TLVSize::ByteString(ActorIdentityTable::kMaxIdLength)),
+
+        kMaxEncodedSize = TLVSize::Structure(3 * TLVSize::Int32() + kMaxBoltLockActorSize + TLVSize::Int64()),
+
+        kMaxStateChangeEventSize = TLVSize::Structure(3 * TLVSize::Int32() + kMaxBoltLockActorSize),
+
+        // Every leaf encoded as an anonymous element.
+        kMaxSnapshotSize = 4 * TLVSize::Int32(TLVSize::kAnonymous) +
+            2 * TLVSize::ByteString(ActorIdentityTable::kMaxIdLength, TLVSize::kAnonymous) +
+            TLVSize::Int64(TLVSize::kAnonymous),
+    };
+
     BoltLockTraitDataSource();
 
     bool IsLocked();
-    void InitiateLock(int32_t aLockActor);
-    void InitiateUnlock(int32_t aLockActor);
+
+    // The originator and agent are ActorIdentityTable indices.  The trait takes over the
+    // references they carry.
+    void InitiateLock(int32_t aLockActor, ActorIdentityTable::Index aOriginator, ActorIdentityTable::Index aAgent);
+    void InitiateUnlock(int32_t aLockActor, ActorIdentityTable::Index aOriginator, ActorIdentityTable::Index aAgent);
 
     void LockingSuccessful(void);
     void UnlockingSuccessful(void);
 
+    // Applies state published by the app task to the trait's dirty set.  Must be called on
+    // the Weave task before running the notification engine.  Returns true if anything changed.
+    bool FlushPendingChanges(void);
+
+    // Leaf encodings served from the shared snapshot, and snapshots built.
+    uint32_t GetSnapshotReadCount(void) const { return mSnapshotReadCount; }
+    uint32_t GetSnapshotBuildCount(void) const { return mSnapshotBuildCount; }
+
+#if APP_DEFERRED_COMMAND_RESPONSE
+    // Fields of the response sent when a deferred BoltLockChangeRequest completes.
+    enum BoltLockChangeResponseParameters
+    {
+        kBoltLockChangeResponseParameter_State         = 1,
+        kBoltLockChangeResponseParameter_ActuatorState = 2,
+        kBoltLockChangeResponseParameter_LockedState   = 3,
+        kBoltLockChangeResponseParameter_DurationMS    = 4,
+    };
+
+    enum
+    {
+        kMaxBoltLockChangeResponseSize = TLVSize::Structure(4 * TLVSize::Int32(), TLVSize::kAnonymous),
+    };
+
+    void CompletePendingCommand(void);
+#endif
+
 private:
     WEAVE_ERROR GetLeafData(::nl::Weave::Profiles::DataManagement_Current::PropertyPathHandle aLeafHandle, uint64_t aTagToWrite,
                             ::nl::Weave::TLV::TLVWriter & aWriter);
@@ -48,10 +111,73 @@ private:
                          const int64_t & aExpiryTimeMicroSecond, const bool aIsMustBeVersionValid, const uint64_t & aMustBeVersion,
                          nl::Weave::TLV::TLVReader & aArgumentReader);
 
-    int32_t mLockedState;
-    int32_t mLockActor;
-    int32_t mActuatorState;
-    int32_t mState;
+    WEAVE_ERROR EncodeLeaf(const BoltLockState & aState,
+                           ::nl::Weave::Profiles::DataManagement_Current::PropertyPathHandle aLeafHandle,
+                           uint64_t aTagToWrite, ::nl::Weave::TLV::TLVWriter & aWriter);
+    WEAVE_ERROR BuildSnapshot(void);
+
+    // An urgent event makes the event logger start an offload straight away.
+    void LogStateChangeEvent(bool aIsUrgent);
+
+    static WEAVE_ERROR InternActorId(nl::Weave::TLV::TLVReader & aReader, ActorIdentityTable::Index & aIndex);
+    static WEAVE_ERROR PutActorId(nl::Weave::TLV::TLVWriter & aWriter, uint64_t aTag, ActorIdentityTable::Index aIndex);
+    static void SetActorId(nl::SerializedByteString & aId, ActorIdentityTable::Index aIndex);
+
+    void SendCachedResponse(nl::Weave::Profiles::DataManagement::Command * aCommand,
+                            const CommandResponseCache::Entry & aEntry);
+
+    CommandResponseCache mCommandCache;
+
+#if APP_DEFERRED_COMMAND_RESPONSE
+    static void AsyncCompletePendingCommand(intptr_t arg);
+    static void HandlePendingCommandTimeout(nl::Weave::System::Layer * aLayer, void * aAppState,
+                                            nl::Weave::System::Error aError);
+    void FinishPendingCommand(bool aTimedOut);
+    WEAVE_ERROR EncodeCommandResponse(nl::Weave::PacketBuffer * aBuf, uint32_t aDurationMS);
+
+    nl::Weave::Profiles::DataManagement::Command * mPendingCommand;
+    CommandResponseCache::Key mPendingKey;
+    uint64_t mPendingStartTimeMS;
+    bool mIsPendingKeyValid;
+#endif
+
+    static uint32_t HandleBit(::nl::Weave::Profiles::DataManagement_Current::PropertyPathHandle aHandle)
+    {
+        return (1UL << aHandle);
+    }
+
+    void SetActor(int32_t aLockActor, ActorIdentityTable::Index aOriginator, ActorIdentityTable::Index aAgent);
+    void PublishState(uint32_t aDirtyHandles);
+    void ReadState(BoltLockState & aState) const;
+
+    // State as last modified by the app task.  Only the app task accesses this copy.
+    BoltLockState mWorkingState;
+
+    // Double-buffered snapshot of the published state, read by the Weave task.
+    BoltLockState mStateBuffers[2];
+    uint8_t mActiveStateBuffer;
+    uint32_t mStateSequence;
+    uint32_t mPendingDirtyHandles;
+
+    // The published state as of the last flush, which is what the current data version
+    // describes, and its encoding, built once per data version on the Weave task and copied
+    // into each subscriber's notify.  Each leaf is an anonymous element.
+    BoltLockState mFlushedState;
+
+    struct Snapshot
+    {
+        uint8_t Data[kMaxSnapshotSize];
+        uint8_t Offset[::Schema::Weave::Trait::Security::BoltLockTrait::kLastSchemaHandle + 1];
+        uint8_t Length[::Schema::Weave::Trait::Security::BoltLockTrait::kLastSchemaHandle + 1];
+    };
+
+    static_assert(kMaxSnapshotSize <= UINT8_MAX, "Snapshot offsets must fit in a uint8_t");
+
+    Snapshot mSnapshot;
+    uint64_t mSnapshotVersion;
+    bool mIsSnapshotValid;
+    uint32_t mSnapshotReadCount;
+    uint32_t mSnapshotBuildCount;
 };
 
 #endif /* BOLT_LOCK_TRAIT_DATA_SOURCE_H */
@@ -26,6 +26,12 @@
 #define DEVICE_IDENTITY_TRAIT_DATA_SOURCE_H
 
 #include <Weave/Profiles/data-management/TraitData.h>
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+#include <schema/include/DeviceIdentityTrait.h>
+
+#include "AppConfig.h"
+#include "TLVSize.h"
+#include "WdmMessageSize.h"
 
 /**
  *  @class DeviceIdentityTraitDataSource
@@ -33,15 +39,62 @@
  *  @brief
  *    Implements a data source for the Weave DeviceIdentityTrait.
  *
+ *    The identity values are read from the configuration manager once, and kept
+ *    as a snapshot of pre-encoded TLV that subscribers are served from.  The
+ *    snapshot is rebuilt when the device's fabric membership changes.
+ *
  */
 class DeviceIdentityTraitDataSource : public ::nl::Weave::Profiles::DataManagement_Current::TraitDataSource
 {
 public:
     DeviceIdentityTraitDataSource(void);
 
+    WEAVE_ERROR Init(void);
+
 private:
+    enum
+    {
+        kMaxSerialNumberLength     = ::nl::Weave::DeviceLayer::ConfigurationManager::kMaxSerialNumberLength,
+        kMaxFirmwareRevisionLength = ::nl::Weave::DeviceLayer::ConfigurationManager::kMaxFirmwareRevisionLength,
+        kManufacturingDateLength   = 10, // YYYY-MM-DD
+
+        // Worst-case encoded size of all leaves as anonymous elements.
+        kSnapshotBufferSize = 3 * TLVSize::Int16(TLVSize::kAnonymous) + 2 * TLVSize::Int64(TLVSize::kAnonymous) +
+            TLVSize::String(kMaxSerialNumberLength, TLVSize::kAnonymous) +
+            TLVSize::String(kMaxFirmwareRevisionLength, TLVSize::kAnonymous) +
+            TLVSize::String(kManufacturingDateLength, TLVSize::kAnonymous),
+
+        // Worst-case encoded size of the whole trait instance.
+        kMaxEncodedSize = TLVSize::Structure(3 * TLVSize::Int16() + 2 * TLVSize::Int64() +
+                                             TLVSize::String(kMaxSerialNumberLength) +
+                                             TLVSize::String(kMaxFirmwareRevisionLength) +
+                                             TLVSize::String(kManufacturingDateLength)),
+
+        kNumHandles = ::Schema::Weave::Trait::Description::DeviceIdentityTrait::kLastSchemaHandle + 1,
+    };
+
+    // Each leaf is encoded as an anonymous element; an empty leaf is not written at all.
+    struct Snapshot
+    {
+        uint8_t Data[kSnapshotBufferSize];
+        uint8_t Offset[kNumHandles];
+        uint8_t Length[kNumHandles];
+    };
+
+    static_assert(kSnapshotBufferSize <= UINT8_MAX, "Snapshot offsets must fit in a uint8_t");
+    static_assert(WdmMessageSize::FitsInNotify(kMaxEncodedSize), "DeviceIdentityTrait can exceed a single notify");
+
     WEAVE_ERROR GetLeafData(::nl::Weave::Profiles::DataManagement_Current::PropertyPathHandle aLeafHandle, uint64_t aTagToWrite,
                             ::nl::Weave::TLV::TLVWriter & aWriter) override;
+
+    WEAVE_ERROR EncodeLeaf(::nl::Weave::Profiles::DataManagement_Current::PropertyPathHandle aLeafHandle, uint64_t aTagToWrite,
+                           ::nl::Weave::TLV::TLVWriter & aWriter);
+    WEAVE_ERROR BuildSnapshot(void);
+
+    static void HandlePlatformEvent(const ::nl::Weave::DeviceLayer::WeaveDeviceEvent * event, intptr_t arg);
+
+    Snapshot mSnapshot;
+    bool mIsSnapshotValid;
 };
 
 #endif // DEVICE_IDENTITY_TRAIT_DATA_SOURCE_H
@@ -0,0 +1,85 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/**
+ *    @file
+ *      A trait data source publishing the service subscription metrics.
+ *
+ */
+
+#ifndef SUBSCRIPTION_DIAGNOSTICS_TRAIT_DATA_SOURCE_H
+#define SUBSCRIPTION_DIAGNOSTICS_TRAIT_DATA_SOURCE_H
+
+#include <Weave/Profiles/data-management/TraitData.h>
+#include <Weave/DeviceLayer/WeaveDeviceLayer.h>
+#include <schema/include/SubscriptionDiagnosticsTrait.h>
+
+#include "AppConfig.h"
+#include "RttEstimator.h"
+#include "SubscriptionMetrics.h"
+#include "TLVSize.h"
+#include "WdmMessageSize.h"
+
+/**
+ *  @class SubscriptionDiagnosticsTraitDataSource
+ *
+ *  @brief
+ *    Serves SubscriptionMetrics and the service RTT estimates to subscribers.  The metrics change with every
+ *    subscription event, including the notifies that would publish them, so the
+ *    trait is not marked dirty as they change.  New subscriptions read the
+ *    current values, and the whole trait is republished periodically.
+ *
+ */
+class SubscriptionDiagnosticsTraitDataSource : public ::nl::Weave::Profiles::DataManagement_Current::TraitDataSource
+{
+public:
+    SubscriptionDiagnosticsTraitDataSource(const SubscriptionMetrics & aMetrics, const RttEstimator & aServiceRtt);
+
+    WEAVE_ERROR Init(void);
+
+    enum
+    {
+        kMaxHistogramSize =
+            TLVSize::Array(SubscriptionMetrics::kNumHistogramBuckets * TLVSize::Int32(TLVSize::kAnonymous)),
+
+        kMaxTerminationReasonSize =
+            TLVSize::Structure(TLVSize::Int32() + TLVSize::Int16() + TLVSize::Int32(), TLVSize::kAnonymous),
+
+        kMaxEncodedSize = TLVSize::Structure(
+            3 * kMaxHistogramSize + 7 * TLVSize::Int32() +
+            TLVSize::Array(SubscriptionMetrics::kResubscribeCause_Max * TLVSize::Int32(TLVSize::kAnonymous)) +
+            TLVSize::Array(SubscriptionMetrics::kMaxTerminationReasons * kMaxTerminationReasonSize)),
+    };
+
+    static_assert(WdmMessageSize::FitsInNotify(kMaxEncodedSize), "SubscriptionDiagnosticsTrait can exceed a single notify");
+
+private:
+    WEAVE_ERROR GetLeafData(::nl::Weave::Profiles::DataManagement_Current::PropertyPathHandle aLeafHandle,
+                            uint64_t aTagToWrite, ::nl::Weave::TLV::TLVWriter & aWriter) override;
+
+    static WEAVE_ERROR PutHistogram(::nl::Weave::TLV::TLVWriter & aWriter, uint64_t aTag,
+                                    const SubscriptionMetrics::Histogram & aHistogram);
+
+    static void HandlePublishTimer(::nl::Weave::System::Layer * aLayer, void * aAppState,
+                                   ::nl::Weave::System::Error aError);
+
+    const SubscriptionMetrics & mMetrics;
+    const RttEstimator & mServiceRtt;
+};
+
+#endif // SUBSCRIPTION_DIAGNOSTICS_TRAIT_DATA_SOURCE_H
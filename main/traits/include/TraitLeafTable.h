@@ -0,0 +1,176 @@
+/*
+ *
+ *    Copyright (c) 2019 Google LLC.
+ *    All rights reserved.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *        http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+/**
+ *    @file
+ *      A table-driven encoder for trait leaves that are held as plain fields of a
+ *      data source's state structure.
+ *
+ *      A data source lists one entry per property handle, in handle order, naming
+ *      the state field that holds each leaf:
+ *
+ *          constexpr TraitLeafTable<State>::Leaf sLeaves[] = {
+ *              TRAIT_LEAF_NONE(0),
+ *              TRAIT_LEAF_NONE(kPropertyHandle_Root),
+ *              TRAIT_LEAF(kPropertyHandle_State, State, State),
+ *              TRAIT_LEAF_CUSTOM(kPropertyHandle_LastChangedAt),
+ *          };
+ *
+ *      GetLeafData() then encodes every field-backed leaf through the table, leaving
+ *      only computed (custom) leaves to a switch statement.  Adding a plain leaf to a
+ *      trait takes a table entry rather than a new case, and the static asserts keep
+ *      the table in step with the schema.  This is a restructuring of the encoder; it
+ *      has not been measured to be faster than the switch it replaces.
+ *
+ */
+
+#ifndef TRAIT_LEAF_TABLE_H
+#define TRAIT_LEAF_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <Weave/Profiles/data-management/DataManagement.h>
+
+enum TraitLeafType
+{
+    kTraitLeafType_None = 0, // Not a leaf (root, structures, unused handles).
+    kTraitLeafType_Custom,   // Encoded by the data source itself.
+    kTraitLeafType_Bool,
+    kTraitLeafType_Int32,
+    kTraitLeafType_UInt16,
+    kTraitLeafType_UInt32,
+    kTraitLeafType_UInt64,
+};
+
+template <typename T>
+struct TraitLeafTypeOf;
+
+template <>
+struct TraitLeafTypeOf<bool>
+{
+    static constexpr TraitLeafType kType = kTraitLeafType_Bool;
+};
+
+template <>
+struct TraitLeafTypeOf<int32_t>
+{
+    static constexpr TraitLeafType kType = kTraitLeafType_Int32;
+};
+
+template <>
+struct TraitLeafTypeOf<uint16_t>
+{
+    static constexpr TraitLeafType kType = kTraitLeafType_UInt16;
+};
+
+template <>
+struct TraitLeafTypeOf<uint32_t>
+{
+    static constexpr TraitLeafType kType = kTraitLeafType_UInt32;
+};
+
+template <>
+struct TraitLeafTypeOf<uint64_t>
+{
+    static constexpr TraitLeafType kType = kTraitLeafType_UInt64;
+};
+
+#define TRAIT_LEAF(HANDLE, STATE, FIELD)                                                                                        \
+    {                                                                                                                          \
+        (HANDLE), TraitLeafTypeOf<decltype(STATE::FIELD)>::kType, static_cast<uint16_t>(offsetof(STATE, FIELD))               \
+    }
+#define TRAIT_LEAF_CUSTOM(HANDLE)                                                                                              \
+    {                                                                                                                          \
+        (HANDLE), kTraitLeafType_Custom, 0                                                                                     \
+    }
+#define TRAIT_LEAF_NONE(HANDLE)                                                                                                \
+    {                                                                                                                          \
+        (HANDLE), kTraitLeafType_None, 0                                                                                       \
+    }
+
+template <typename StateT>
+class TraitLeafTable
+{
+public:
+    typedef ::nl::Weave::Profiles::DataManagement::PropertyPathHandle PropertyPathHandle;
+
+    struct Leaf
+    {
+        PropertyPathHandle Handle;
+        TraitLeafType Type;
+        uint16_t Offset;
+    };
+
+    template <size_t N>
+    constexpr TraitLeafTable(const Leaf (&aLeaves)[N]) : mLeaves(aLeaves), mNumLeaves(N)
+    {
+    }
+
+    // For a static_assert: entries must be listed in handle order, starting at 0.
+    constexpr bool IsIndexedByHandle(size_t aIndex = 0) const
+    {
+        return (aIndex == mNumLeaves) || (mLeaves[aIndex].Handle == aIndex && IsIndexedByHandle(aIndex + 1));
+    }
+
+    // True if the leaf is held in the state structure and can be written by WriteLeaf().
+    bool IsFieldLeaf(PropertyPathHandle aHandle) const
+    {
+        return (aHandle < mNumLeaves && mLeaves[aHandle].Type > kTraitLeafType_Custom);
+    }
+
+    WEAVE_ERROR WriteLeaf(const StateT & aState, PropertyPathHandle aHandle, uint64_t aTagToWrite,
+                          ::nl::Weave::TLV::TLVWriter & aWriter) const
+    {
+        const uint8_t * field;
+
+        if (!IsFieldLeaf(aHandle))
+        {
+            return WEAVE_ERROR_INVALID_ARGUMENT;
+        }
+
+        field = reinterpret_cast<const uint8_t *>(&aState) + mLeaves[aHandle].Offset;
+
+        switch (mLeaves[aHandle].Type)
+        {
+        case kTraitLeafType_Bool:
+            return aWriter.PutBoolean(aTagToWrite, *reinterpret_cast<const bool *>(field));
+
+        case kTraitLeafType_Int32:
+            return aWriter.Put(aTagToWrite, *reinterpret_cast<const int32_t *>(field));
+
+        case kTraitLeafType_UInt16:
+            return aWriter.Put(aTagToWrite, *reinterpret_cast<const uint16_t *>(field));
+
+        case kTraitLeafType_UInt32:
+            return aWriter.Put(aTagToWrite, *reinterpret_cast<const uint32_t *>(field));
+
+        case kTraitLeafType_UInt64:
+            return aWriter.Put(aTagToWrite, *reinterpret_cast<const uint64_t *>(field));
+
+        default:
+            return WEAVE_ERROR_INVALID_ARGUMENT;
+        }
+    }
+
+private:
+    const Leaf * mLeaves;
+    size_t mNumLeaves;
+};
+
+#endif // TRAIT_LEAF_TABLE_H